@@ -11,8 +11,12 @@ SOURCES += \
     test/statistic_policy_test.cpp \
     test/stl_test.cpp \
     test/linear_alloc_test.cpp \
+    test/lockfree_freelist_test.cpp \
+    test/small_object_alloc_test.cpp \
+    test/frame_alloc_test.cpp \
     test/details/alloc_type_traits_test.cpp \
     test/details/policies_list_test.cpp \
+    test/details/purge_test.cpp \
     test/details/rebind_test.cpp \
     test/concepts/concepts_test.cpp
 
@@ -24,13 +28,25 @@ HEADERS += \
     include/allocator/none_policy.hpp \
     include/allocator/pointer_cast.hpp \
     include/allocator/pool_allocation.hpp \
+    include/allocator/pool_growth.hpp \
+    include/allocator/small_object_allocation.hpp \
     include/allocator/statistic_policy.hpp \
     include/allocator/details/memory_pool.hpp \
+    include/allocator/details/thread_cache.hpp \
     include/allocator/details/policies_list.hpp \
     include/allocator/alloc_type_traits.hpp \
     include/allocator/details/rebind.hpp \
     include/allocator/linear_allocation.hpp \
     include/allocator/details/linear_storage.hpp \
+    include/allocator/details/concurrent_linear_storage.hpp \
+    include/allocator/details/tlab_cache.hpp \
+    include/allocator/monotonic_allocation.hpp \
+    include/allocator/details/linear_arena.hpp \
+    include/allocator/frame_allocation.hpp \
+    include/allocator/lockfree_freelist.hpp \
+    include/allocator/details/lockfree_stack.hpp \
+    include/allocator/details/purge.hpp \
+    include/allocator/details/upstream.hpp \
     include/allocator/pointer_concepts.hpp \
     include/allocator/details/alloc_type_traits.hpp \
     include/allocator/details/is_swappable.hpp \
@@ -41,5 +57,5 @@ HEADERS += \
 
 INCLUDEPATH += include/allocator test
 
-LIBS += -lgtest -lgtest_main -pthread
+LIBS += -lgtest -lgtest_main -pthread -latomic
 
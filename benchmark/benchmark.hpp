@@ -0,0 +1,95 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+
+struct benchmark_case
+{
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<benchmark_case>& registry()
+{
+    static std::vector<benchmark_case> cases;
+    return cases;
+}
+
+struct registrar
+{
+    registrar(const char* name, void (*run)())
+    {
+        registry().push_back(benchmark_case{name, run});
+    }
+};
+
+class timer
+{
+    typedef std::chrono::steady_clock clock;
+
+public:
+
+    timer():
+        m_start(clock::now())
+    {}
+
+    void reset()
+    {
+        m_start = clock::now();
+    }
+
+    double elapsed_ns() const
+    {
+        return std::chrono::duration<double, std::nano>(clock::now() - m_start).count();
+    }
+
+private:
+    clock::time_point m_start;
+};
+
+// prevents compiler from throwing away computations which results are not used
+
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// returns resident set size of the process in bytes (or 0 if it is unknown on the platform)
+
+inline std::size_t rss_bytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    std::size_t pages = 0;
+    std::size_t resident = 0;
+    statm >> pages >> resident;
+    return resident * 4096;
+#else
+    return 0;
+#endif
+}
+
+// prints one row of benchmark results
+
+inline void report(const char* name, const std::string& params, double value, const char* unit)
+{
+    std::printf("%-32s %-40s %14.2f %s\n", name, params.c_str(), value, unit);
+    std::fflush(stdout);
+}
+
+} // namespace benchmark
+
+#define BENCHMARK(name)                                                         \
+    static void name();                                                         \
+    static ::benchmark::registrar name##_registrar(#name, &name);               \
+    static void name()
+
+#endif // BENCHMARK_HPP
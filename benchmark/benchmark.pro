@@ -0,0 +1,33 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+CONFIG += c++11
+
+SOURCES += \
+    main.cpp \
+    freelist_mpmc_bench.cpp \
+    linear_arena_bench.cpp \
+    linear_resize_bench.cpp \
+    linear_scope_bench.cpp \
+    linear_threads_bench.cpp \
+    pool_batch_bench.cpp \
+    pool_churn_bench.cpp \
+    pool_coloring_bench.cpp \
+    pool_contention_bench.cpp \
+    pool_dealloc_bench.cpp \
+    pool_false_sharing_bench.cpp \
+    pool_growth_bench.cpp \
+    pool_prefetch_bench.cpp \
+    pool_purge_bench.cpp \
+    pool_rebind_bench.cpp \
+    pool_remote_free_bench.cpp \
+    pool_reserve_bench.cpp \
+    pool_threads_bench.cpp
+
+HEADERS += \
+    benchmark.hpp
+
+INCLUDEPATH += ../include/allocator
+
+LIBS += -pthread -latomic
@@ -0,0 +1,85 @@
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "lockfree_freelist.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    std::atomic<node*> next;
+    std::uint64_t payload;
+};
+
+typedef lockfree_freelist_policy<node> freelist_allocator;
+typedef default_allocation_policy<node> new_allocator;
+
+const size_t SLOTS_NUM = 1024;
+const size_t OPS_NUM = 1 << 20;
+
+// every thread is both producer and consumer: it allocates a node, publishes it in a random slot
+// and deallocates the node previously published there (most likely by another thread)
+
+template <typename alloc_type>
+void mpmc_thread(alloc_type alloc, std::vector<std::atomic<node*>>& slots, unsigned seed)
+{
+    std::minstd_rand eng(seed);
+    for (size_t i = 0; i < OPS_NUM; ++i) {
+        node* ptr = alloc.allocate(1, nullptr);
+        ptr->payload = i;
+        node* old = slots[eng() % SLOTS_NUM].exchange(ptr, std::memory_order_acq_rel);
+        if (old) {
+            benchmark::do_not_optimize(old->payload);
+            alloc.deallocate(old, 1);
+        }
+    }
+}
+
+template <typename alloc_type>
+void mpmc(const char* alloc_name)
+{
+    for (size_t threads_num: {1, 2, 4, 8, 16}) {
+        alloc_type alloc;
+        std::vector<std::atomic<node*>> slots(SLOTS_NUM);
+        for (auto& slot: slots) {
+            slot.store(nullptr);
+        }
+
+        std::vector<std::thread> threads;
+        benchmark::timer timer;
+        for (size_t i = 0; i < threads_num; ++i) {
+            threads.emplace_back(mpmc_thread<alloc_type>, alloc, std::ref(slots), static_cast<unsigned>(i + 1));
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        benchmark::report("freelist_mpmc", std::string("alloc=") + alloc_name + ",threads=" + std::to_string(threads_num),
+                          timer.elapsed_ns() / (threads_num * OPS_NUM), "ns/(alloc+free)");
+
+        for (auto& slot: slots) {
+            if (slot.load()) {
+                alloc.deallocate(slot.load(), 1);
+            }
+        }
+    }
+}
+
+}
+
+// measures node recycling when nodes are allocated and deallocated by different threads
+
+BENCHMARK(freelist_mpmc)
+{
+    mpmc<freelist_allocator>("lockfree_freelist");
+    mpmc<new_allocator>("new");
+}
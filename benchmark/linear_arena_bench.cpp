@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <string>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "linear_allocation.hpp"
+#include "monotonic_allocation.hpp"
+#include "statistic_policy.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload;
+};
+
+typedef default_allocation_policy<node, allocation_traits<node>, statistic_policy<node>> upstream_policy;
+typedef linear_allocation_policy<node, allocation_traits<node>, upstream_policy> linear_allocator;
+typedef monotonic_allocation_policy<node, allocation_traits<node>, upstream_policy> monotonic_allocator;
+
+const size_t OBJS_NUM = 1 << 20;
+const size_t STORAGE_SIZE = 1 << 12;
+
+// builds a list of OBJS_NUM nodes, walks it and frees it node by node,
+// reports upstream allocations and time per node
+
+template <typename allocator_type>
+void run_list(allocator_type& alloc, const std::string& name, typename allocator_type::statistic_type& stat)
+{
+    benchmark::timer timer;
+    node* head = nullptr;
+    for (size_t i = 0; i < OBJS_NUM; ++i) {
+        node* ptr = alloc.allocate(1, nullptr);
+        ptr->next = head;
+        ptr->payload = i;
+        head = ptr;
+    }
+    std::uint64_t sum = 0;
+    for (node* ptr = head; ptr; ptr = ptr->next) {
+        sum += ptr->payload;
+    }
+    while (head) {
+        node* next = head->next;
+        alloc.deallocate(head, 1);
+        head = next;
+    }
+    double elapsed_ns = timer.elapsed_ns();
+    benchmark::do_not_optimize(sum);
+    benchmark::report("linear_arena", name + " upstream allocations", stat.allocs_count(), "calls");
+    benchmark::report("linear_arena", name + " build/walk/free", elapsed_ns / OBJS_NUM, "ns/node");
+}
+
+}
+
+// compares the linear storage of fixed size falling back to base_policy when it is exhausted
+// with the monotonic arena which chains geometrically growing regions
+
+BENCHMARK(linear_arena)
+{
+    if (true) {
+        upstream_policy::statistic_type stat;
+        linear_allocator alloc;
+        alloc.set_statistic(&stat);
+        alloc.allocate_storage(STORAGE_SIZE);
+        run_list(alloc, "linear with fallback", stat);
+    }
+    if (true) {
+        upstream_policy::statistic_type stat;
+        monotonic_allocator alloc(STORAGE_SIZE * sizeof(node));
+        alloc.set_statistic(&stat);
+        run_list(alloc, "monotonic", stat);
+    }
+}
@@ -0,0 +1,78 @@
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "allocator.hpp"
+#include "linear_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+typedef linear_allocation_policy<int> int_policy;
+typedef allocator<int, allocation_traits<int>, int_policy, default_allocation_policy<int>> int_allocator;
+
+const std::size_t OBJS_NUM = 1 << 18;
+const std::size_t STORAGE_SIZE = 1 << 22;
+
+// appends to a buffer growing by half like std::vector does,
+// the buffer is expanded in place when it is the last allocation from the storage
+
+void push_back(int_allocator& alloc, int*& data, std::size_t& size, std::size_t& capacity, int value)
+{
+    if (size == capacity) {
+        std::size_t new_capacity = capacity + capacity / 2 + 1;
+        if (!alloc.expand(data, capacity, new_capacity)) {
+            int* new_data = alloc.allocate(new_capacity);
+            std::memcpy(new_data, data, size * sizeof(int));
+            alloc.deallocate(data, capacity);
+            data = new_data;
+        }
+        capacity = new_capacity;
+    }
+    data[size++] = value;
+}
+
+void report(int_allocator& alloc, const std::string& name, double elapsed_ns)
+{
+    benchmark::report("linear_resize", name + " storage used", alloc.get_marker() / 1024.0, "KiB");
+    benchmark::report("linear_resize", name + " push_back", elapsed_ns / OBJS_NUM, "ns/push");
+}
+
+}
+
+// grows a buffer of 1 MiB of ints inside the linear storage by std::vector,
+// which leaves every previous buffer behind, and by in place expansion of the last allocation
+
+BENCHMARK(linear_resize)
+{
+    if (true) {
+        int_allocator alloc;
+        alloc.allocate_storage(STORAGE_SIZE);
+        benchmark::timer timer;
+        std::vector<int, int_allocator> vec(alloc);
+        for (std::size_t i = 0; i < OBJS_NUM; ++i) {
+            vec.push_back(static_cast<int>(i));
+        }
+        report(alloc, "std::vector", timer.elapsed_ns());
+        benchmark::do_not_optimize(vec.back());
+    }
+    if (true) {
+        int_allocator alloc;
+        alloc.allocate_storage(STORAGE_SIZE);
+        benchmark::timer timer;
+        int* data = nullptr;
+        std::size_t size = 0;
+        std::size_t capacity = 0;
+        for (std::size_t i = 0; i < OBJS_NUM; ++i) {
+            push_back(alloc, data, size, capacity, static_cast<int>(i));
+        }
+        report(alloc, "expand in place", timer.elapsed_ns());
+        benchmark::do_not_optimize(data[size - 1]);
+    }
+}
@@ -0,0 +1,232 @@
+#include <cstddef>
+#include <new>
+#include <random>
+#include <string>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "linear_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct expr_node
+{
+    char op;
+    double value;
+    expr_node* left;
+    expr_node* right;
+};
+
+// nodes are allocated by new and freed after each (sub)expression is evaluated
+
+class heap_memory
+{
+public:
+
+    struct scope
+    {
+        explicit scope(heap_memory&) noexcept
+        {}
+    };
+
+    expr_node* create()
+    {
+        return new expr_node();
+    }
+
+    void destroy(expr_node* node)
+    {
+        if (node) {
+            destroy(node->left);
+            destroy(node->right);
+            delete node;
+        }
+    }
+};
+
+// nodes are allocated from the linear storage, each (sub)expression rewinds it when it is evaluated
+
+class linear_memory
+{
+public:
+
+    typedef linear_allocation_policy<expr_node> allocator_type;
+
+    struct scope
+    {
+        explicit scope(linear_memory& memory) noexcept:
+            m_scope(memory.m_alloc)
+        {}
+
+        linear_allocation_scope<allocator_type> m_scope;
+    };
+
+    explicit linear_memory(std::size_t size)
+    {
+        m_alloc.allocate_storage(size);
+    }
+
+    expr_node* create()
+    {
+        return new (m_alloc.allocate(1, nullptr)) expr_node();
+    }
+
+    void destroy(expr_node*)
+    {}
+
+private:
+    allocator_type m_alloc;
+};
+
+// recursive descent parser of statements like "1+(2*3-4);", parenthesized subexpressions
+// are evaluated in nested scopes and replaced by their values
+
+template <typename memory_type>
+class parser
+{
+public:
+
+    parser(const std::string& text, memory_type& memory):
+        m_text(text)
+      , m_pos(0)
+      , m_memory(memory)
+    {}
+
+    bool at_end() const
+    {
+        return m_pos >= m_text.size();
+    }
+
+    double parse_statement()
+    {
+        typename memory_type::scope scope(m_memory);
+        expr_node* expr = parse_sum();
+        ++m_pos;
+        double value = eval(expr);
+        m_memory.destroy(expr);
+        return value;
+    }
+
+private:
+
+    expr_node* parse_sum()
+    {
+        expr_node* left = parse_product();
+        while (m_text[m_pos] == '+' || m_text[m_pos] == '-') {
+            left = make_op(m_text[m_pos++], left, parse_product());
+        }
+        return left;
+    }
+
+    expr_node* parse_product()
+    {
+        expr_node* left = parse_primary();
+        while (m_text[m_pos] == '*') {
+            left = make_op(m_text[m_pos++], left, parse_primary());
+        }
+        return left;
+    }
+
+    expr_node* parse_primary()
+    {
+        double value = 0;
+        if (m_text[m_pos] == '(') {
+            typename memory_type::scope scope(m_memory);
+            ++m_pos;
+            expr_node* expr = parse_sum();
+            ++m_pos;
+            value = eval(expr);
+            m_memory.destroy(expr);
+        } else {
+            value = m_text[m_pos++] - '0';
+        }
+        expr_node* node = m_memory.create();
+        node->value = value;
+        return node;
+    }
+
+    expr_node* make_op(char op, expr_node* left, expr_node* right)
+    {
+        expr_node* node = m_memory.create();
+        node->op = op;
+        node->left = left;
+        node->right = right;
+        return node;
+    }
+
+    static double eval(const expr_node* node)
+    {
+        switch (node->op) {
+        case '+':
+            return eval(node->left) + eval(node->right);
+        case '-':
+            return eval(node->left) - eval(node->right);
+        case '*':
+            return eval(node->left) * eval(node->right);
+        default:
+            return node->value;
+        }
+    }
+
+    const std::string& m_text;
+    std::size_t m_pos;
+    memory_type& m_memory;
+};
+
+void generate_expr(std::string& text, std::mt19937& gen, int depth)
+{
+    int terms = 1 + gen() % 4;
+    for (int i = 0; i < terms; ++i) {
+        if (i > 0) {
+            text += "+-*"[gen() % 3];
+        }
+        if (depth > 0 && gen() % 3 == 0) {
+            text += '(';
+            generate_expr(text, gen, depth - 1);
+            text += ')';
+        } else {
+            text += static_cast<char>('0' + gen() % 10);
+        }
+    }
+}
+
+template <typename memory_type>
+void run_parser(const std::string& text, std::size_t statements, memory_type& memory, const std::string& name)
+{
+    benchmark::timer timer;
+    parser<memory_type> p(text, memory);
+    double sum = 0;
+    while (!p.at_end()) {
+        sum += p.parse_statement();
+    }
+    double elapsed_ns = timer.elapsed_ns();
+    benchmark::do_not_optimize(sum);
+    benchmark::report("linear_scope", name, elapsed_ns / statements, "ns/statement");
+}
+
+}
+
+// parses a few hundred thousand nested expressions,
+// temporaries of every subexpression are freed by delete or by rewind of the linear storage
+
+BENCHMARK(linear_scope)
+{
+    const std::size_t STATEMENTS_NUM = 1 << 18;
+
+    std::mt19937 gen(42);
+    std::string text;
+    for (std::size_t i = 0; i < STATEMENTS_NUM; ++i) {
+        generate_expr(text, gen, 6);
+        text += ';';
+    }
+
+    heap_memory heap;
+    run_parser(text, STATEMENTS_NUM, heap, "heap");
+
+    linear_memory linear(1 << 16);
+    run_parser(text, STATEMENTS_NUM, linear, "linear with scopes");
+}
@@ -0,0 +1,100 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "linear_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct token
+{
+    std::uint32_t kind;
+    std::uint32_t offset;
+};
+
+typedef concurrent_linear_allocation_policy<token> concurrent_allocator;
+typedef tlab_linear_allocation_policy<token> tlab_allocator;
+typedef linear_allocation_policy<token> linear_allocator;
+
+// linear policy guarded by a mutex shared by its copies
+
+class locked_allocator
+{
+public:
+
+    locked_allocator():
+        m_mutex(std::make_shared<std::mutex>())
+    {}
+
+    void allocate_storage(std::size_t size)
+    {
+        m_alloc.allocate_storage(size);
+    }
+
+    token* allocate(std::size_t n, std::nullptr_t)
+    {
+        std::lock_guard<std::mutex> lock(*m_mutex);
+        return m_alloc.allocate(n, nullptr);
+    }
+
+private:
+    linear_allocator m_alloc;
+    std::shared_ptr<std::mutex> m_mutex;
+};
+
+// each thread fills the shared arena with tokens like a parsing thread does
+
+template <typename alloc_type>
+void fill_thread(alloc_type alloc, std::size_t tokens_num)
+{
+    for (std::size_t i = 0; i < tokens_num; ++i) {
+        token* ptr = alloc.allocate(1, nullptr);
+        ptr->kind = static_cast<std::uint32_t>(i);
+        ptr->offset = static_cast<std::uint32_t>(i);
+    }
+}
+
+template <typename alloc_type>
+void fill(const char* alloc_name)
+{
+    const std::size_t TOKENS_NUM = 1 << 22;
+
+    for (std::size_t threads_num: {1, 2, 4, 8, 16, 32, 64}) {
+        alloc_type alloc;
+        alloc.allocate_storage(TOKENS_NUM);
+        std::vector<std::thread> threads;
+        benchmark::timer timer;
+        for (std::size_t i = 0; i < threads_num; ++i) {
+            threads.emplace_back(fill_thread<alloc_type>, alloc, TOKENS_NUM / threads_num);
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        double allocs_per_sec = TOKENS_NUM / (timer.elapsed_ns() * 1e-9);
+        benchmark::report("linear_threads",
+                          std::string("alloc=") + alloc_name + ",threads=" + std::to_string(threads_num),
+                          allocs_per_sec * 1e-6, "Mallocs/s");
+    }
+}
+
+}
+
+// measures throughput of allocations from one linear storage shared by threads,
+// lock-free bump allocation and thread local buffers against the mutex guarded storage
+
+BENCHMARK(linear_threads)
+{
+    fill<concurrent_allocator>("concurrent");
+    fill<tlab_allocator>("tlab");
+    fill<locked_allocator>("mutex");
+}
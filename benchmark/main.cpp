@@ -0,0 +1,16 @@
+#include <cstring>
+
+#include "benchmark.hpp"
+
+// runs all registered benchmarks or only those which names contain the first argument
+
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+    for (auto& bench: benchmark::registry()) {
+        if (std::strstr(bench.name, filter)) {
+            bench.run();
+        }
+    }
+    return 0;
+}
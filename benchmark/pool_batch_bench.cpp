@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload;
+};
+
+typedef pool_allocation_policy<node> node_allocator;
+
+}
+
+// compares throughput of creation and destruction of many nodes
+// by single object calls and by allocate_batch/deallocate_batch,
+// each round starts with an empty pool, so it includes the growth of the pool
+
+BENCHMARK(pool_batch_throughput)
+{
+    const size_t BLOCK_SIZE = 4096;
+    const size_t OBJS_NUM = 1 << 20;
+
+    std::vector<node*> ptrs(OBJS_NUM);
+    {
+        node_allocator alloc(BLOCK_SIZE);
+        benchmark::timer timer;
+        for (auto& ptr: ptrs) {
+            ptr = alloc.allocate(1, nullptr);
+        }
+        for (node* ptr: ptrs) {
+            alloc.deallocate(ptr, 1);
+        }
+        benchmark::do_not_optimize(ptrs.data());
+        benchmark::report("pool_batch_throughput", "single",
+                          double(timer.elapsed_ns()) / OBJS_NUM, "ns/(alloc+free)");
+    }
+    for (size_t batch_size: {16, 256, 4096}) {
+        node_allocator alloc(BLOCK_SIZE);
+        benchmark::timer timer;
+        for (size_t i = 0; i < OBJS_NUM; i += batch_size) {
+            alloc.allocate_batch(batch_size, ptrs.begin() + i);
+        }
+        for (size_t i = 0; i < OBJS_NUM; i += batch_size) {
+            alloc.deallocate_batch(ptrs.begin() + i, ptrs.begin() + i + batch_size);
+        }
+        benchmark::do_not_optimize(ptrs.data());
+        benchmark::report("pool_batch_throughput", "batch=" + std::to_string(batch_size),
+                          double(timer.elapsed_ns()) / OBJS_NUM, "ns/(alloc+free)");
+    }
+}
@@ -0,0 +1,66 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload;
+};
+
+typedef pool_allocation_policy<node> node_allocator;
+
+}
+
+// measures latency of deallocation followed by allocation in a mostly full pool
+// depending on number of blocks in the pool
+
+BENCHMARK(pool_churn_latency)
+{
+    const size_t BLOCK_SIZE = 64;
+    const size_t OPS_NUM = 1 << 20;
+
+    std::default_random_engine eng(42);
+    for (size_t blocks_num: {10, 100, 1000, 10000, 100000}) {
+        node_allocator alloc(BLOCK_SIZE);
+        std::vector<node*> ptrs(blocks_num * BLOCK_SIZE);
+        for (auto& ptr: ptrs) {
+            ptr = alloc.allocate(1, nullptr);
+        }
+        // leave about 5% of the pool free, scattered across all blocks
+        std::shuffle(ptrs.begin(), ptrs.end(), eng);
+        size_t live = ptrs.size() - ptrs.size() / 20;
+        for (size_t i = live; i < ptrs.size(); ++i) {
+            alloc.deallocate(ptrs[i], 1);
+        }
+        ptrs.resize(live);
+
+        std::uniform_int_distribution<size_t> distr(0, live - 1);
+        std::vector<size_t> victims(OPS_NUM);
+        for (auto& victim: victims) {
+            victim = distr(eng);
+        }
+
+        benchmark::timer timer;
+        for (size_t victim: victims) {
+            alloc.deallocate(ptrs[victim], 1);
+            ptrs[victim] = alloc.allocate(1, nullptr);
+        }
+        benchmark::report("pool_churn_latency", "blocks=" + std::to_string(blocks_num),
+                          timer.elapsed_ns() / OPS_NUM, "ns/(free+alloc)");
+        for (node* ptr: ptrs) {
+            alloc.deallocate(ptr, 1);
+        }
+    }
+}
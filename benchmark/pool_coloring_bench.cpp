@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload[7];
+};
+
+template <std::size_t COLORS>
+struct colored_pool_traits: public default_pool_traits
+{
+    static const std::size_t CACHE_COLORS = COLORS;
+};
+
+// upstream memory is page aligned, as it is when blocks come from mmap or a page allocator
+
+template <std::size_t COLORS>
+using node_allocator = basic_pool_allocation_policy<node, allocation_traits<node>, colored_pool_traits<COLORS>,
+                            aligned_allocation_policy<node>
+                        >;
+
+// chases pointers through the first objects of all blocks of the pool in random order
+
+template <std::size_t COLORS>
+void chase(const std::string& name)
+{
+    const size_t BLOCK_SIZE = 64;
+    const size_t HOPS_NUM = 1 << 24;
+
+    for (size_t blocks_num: {64, 256, 1024}) {
+        node_allocator<COLORS> alloc(BLOCK_SIZE);
+        alloc.set_alignment(4096);
+        std::vector<node*> nodes;
+        std::vector<node*> heads;
+        for (size_t i = 0; i < blocks_num * BLOCK_SIZE; ++i) {
+            node* ptr = alloc.allocate(1, nullptr);
+            nodes.push_back(ptr);
+            if (i % BLOCK_SIZE == 0) {
+                heads.push_back(ptr);
+            }
+        }
+        std::shuffle(heads.begin(), heads.end(), std::default_random_engine(42));
+        for (size_t i = 0; i < heads.size(); ++i) {
+            heads[i]->next = heads[(i + 1) % heads.size()];
+        }
+
+        node* cur = heads[0];
+        benchmark::timer timer;
+        for (size_t i = 0; i < HOPS_NUM; ++i) {
+            cur = cur->next;
+        }
+        benchmark::do_not_optimize(cur);
+        benchmark::report("pool_coloring_chase", name + ",blocks=" + std::to_string(blocks_num),
+                          timer.elapsed_ns() / HOPS_NUM, "ns/hop");
+
+        for (node* ptr: nodes) {
+            alloc.deallocate(ptr, 1);
+        }
+    }
+}
+
+}
+
+// measures latency of pointer chasing through the first objects of blocks with and without cache coloring
+
+BENCHMARK(pool_coloring_chase)
+{
+    chase<0>("colors=0");
+    chase<8>("colors=8");
+    chase<64>("colors=64");
+}
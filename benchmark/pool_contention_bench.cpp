@@ -0,0 +1,106 @@
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+template <int N>
+struct object
+{
+    char data[N];
+};
+
+struct safe_pool_traits: public default_pool_traits
+{
+    typedef std::mutex mutex_type;
+};
+
+typedef basic_pool_allocation_policy<object<16>, allocation_traits<object<16>>, safe_pool_traits> safe_allocator;
+typedef pool_allocation_policy<object<16>> unsafe_allocator;
+
+const size_t OPS_NUM = 1 << 20;
+const size_t LIVE_NUM = 64;
+
+template <typename alloc_type>
+void churn(alloc_type alloc)
+{
+    typedef typename alloc_type::pointer pointer;
+    std::vector<pointer> ptrs(LIVE_NUM);
+    for (size_t i = 0; i < OPS_NUM / LIVE_NUM; ++i) {
+        for (auto& ptr: ptrs) {
+            ptr = alloc.allocate(1, nullptr);
+        }
+        for (auto& ptr: ptrs) {
+            alloc.deallocate(ptr, 1);
+        }
+    }
+}
+
+// each thread uses its own size class, so threads take different pool locks
+
+template <int N>
+void spawn_distinct(const safe_allocator& alloc, size_t threads_num, std::vector<std::thread>& threads)
+{
+    if (threads.size() == threads_num) {
+        return;
+    }
+    typename safe_allocator::template rebind<object<16 + 8 * N>> other_alloc(alloc);
+    threads.emplace_back(churn<decltype(other_alloc)>, other_alloc);
+    spawn_distinct<N + 1>(alloc, threads_num, threads);
+}
+
+template <>
+void spawn_distinct<16>(const safe_allocator&, size_t, std::vector<std::thread>&)
+{}
+
+void report(const std::string& params, size_t threads_num, const benchmark::timer& timer)
+{
+    benchmark::report("pool_contention", params + ",threads=" + std::to_string(threads_num),
+                      timer.elapsed_ns() / (threads_num * OPS_NUM), "ns/(alloc+free)");
+}
+
+}
+
+// measures alloc/free pairs of thread safe pools when threads share one size class
+// and when each thread uses its own size class, compared to pools without locking
+
+BENCHMARK(pool_contention)
+{
+    {
+        benchmark::timer timer;
+        churn(unsafe_allocator());
+        report("locks=none", 1, timer);
+    }
+    for (size_t threads_num: {1, 2, 4, 8, 16}) {
+        safe_allocator alloc;
+        std::vector<std::thread> threads;
+        benchmark::timer timer;
+        for (size_t i = 0; i < threads_num; ++i) {
+            threads.emplace_back(churn<safe_allocator>, alloc);
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        report("locks=pool,classes=shared", threads_num, timer);
+    }
+    for (size_t threads_num: {1, 2, 4, 8, 16}) {
+        safe_allocator alloc;
+        std::vector<std::thread> threads;
+        benchmark::timer timer;
+        spawn_distinct<0>(alloc, threads_num, threads);
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        report("locks=pool,classes=distinct", threads_num, timer);
+    }
+}
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload;
+};
+
+typedef pool_allocation_policy<node> node_allocator;
+
+}
+
+// measures latency of single object deallocation depending on number of blocks in the pool
+
+BENCHMARK(pool_dealloc_latency)
+{
+    const size_t BLOCK_SIZE = 16;
+    const size_t FREES_NUM = 1 << 20;
+    const size_t SAMPLE_SIZE = 1 << 12;
+
+    std::default_random_engine eng(42);
+    for (size_t blocks_num: {10, 100, 1000, 10000, 100000}) {
+        node_allocator alloc(BLOCK_SIZE);
+        std::vector<node*> ptrs;
+        for (size_t i = 0; i < blocks_num * BLOCK_SIZE; ++i) {
+            ptrs.push_back(alloc.allocate(1, nullptr));
+        }
+
+        double total_ns = 0;
+        size_t frees = 0;
+        while (frees < FREES_NUM) {
+            std::shuffle(ptrs.begin(), ptrs.end(), eng);
+            size_t sample = std::min(SAMPLE_SIZE, ptrs.size());
+
+            benchmark::timer timer;
+            for (size_t i = 0; i < sample; ++i) {
+                alloc.deallocate(ptrs[i], 1);
+            }
+            total_ns += timer.elapsed_ns();
+            frees += sample;
+
+            for (size_t i = 0; i < sample; ++i) {
+                ptrs[i] = alloc.allocate(1, nullptr);
+            }
+        }
+        benchmark::report("pool_dealloc_latency", "blocks=" + std::to_string(blocks_num),
+                          total_ns / frees, "ns/free");
+        for (node* ptr: ptrs) {
+            alloc.deallocate(ptr, 1);
+        }
+    }
+}
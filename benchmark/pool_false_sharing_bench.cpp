@@ -0,0 +1,69 @@
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct counter
+{
+    std::atomic<std::uint64_t> value;
+};
+
+// each thread increments its own counter allocated from the pool,
+// counters of packed pool share cache lines while counters of cache aligned pool don't
+
+template <typename alloc_type>
+void count(const char* alloc_name)
+{
+    const size_t INCREMENTS_NUM = 1 << 24;
+
+    for (size_t threads_num: {1, 2, 4, 8}) {
+        alloc_type alloc;
+        std::vector<counter*> counters;
+        for (size_t i = 0; i < threads_num; ++i) {
+            counter* ptr = alloc.allocate(1, nullptr);
+            ptr->value.store(0, std::memory_order_relaxed);
+            counters.push_back(ptr);
+        }
+
+        std::vector<std::thread> threads;
+        benchmark::timer timer;
+        for (size_t i = 0; i < threads_num; ++i) {
+            threads.emplace_back([INCREMENTS_NUM](counter* ptr) {
+                for (size_t j = 0; j < INCREMENTS_NUM; ++j) {
+                    ptr->value.fetch_add(1, std::memory_order_relaxed);
+                }
+            }, counters[i]);
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        benchmark::report("pool_false_sharing",
+                          std::string("alloc=") + alloc_name + ",threads=" + std::to_string(threads_num),
+                          timer.elapsed_ns() / INCREMENTS_NUM, "ns/increment");
+
+        for (counter* ptr: counters) {
+            alloc.deallocate(ptr, 1);
+        }
+    }
+}
+
+}
+
+// measures the cost of false sharing between per thread counters allocated from the same pool
+
+BENCHMARK(pool_false_sharing)
+{
+    count<pool_allocation_policy<counter>>("packed");
+    count<cache_aligned_pool_allocation_policy<counter>>("cache_aligned");
+}
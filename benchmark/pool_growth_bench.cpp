@@ -0,0 +1,76 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+#include "statistic_policy.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload;
+};
+
+template <typename strategy>
+struct growth_pool_traits: public default_pool_traits
+{
+    typedef strategy growth_strategy;
+};
+
+template <typename strategy>
+using node_allocator = basic_pool_allocation_policy<node, allocation_traits<node>, growth_pool_traits<strategy>,
+                            default_allocation_policy<node, allocation_traits<node>,
+                                statistic_policy<node>
+                            >
+                        >;
+
+// grows the pool to OBJS_NUM objects, reports upstream allocations and latency of single allocations
+
+template <typename strategy>
+void run_growth(const std::string& name)
+{
+    const size_t OBJS_NUM = 1 << 22;
+
+    typedef node_allocator<strategy> allocator_type;
+    typename allocator_type::statistic_type stat;
+    allocator_type alloc;
+    alloc.set_statistic(&stat);
+    std::vector<node*> ptrs;
+    ptrs.reserve(OBJS_NUM);
+
+    benchmark::timer timer;
+    for (size_t i = 0; i < OBJS_NUM; ++i) {
+        node* ptr = alloc.allocate(1, nullptr);
+        ptr->payload = i;
+        ptrs.push_back(ptr);
+    }
+    double elapsed_ns = timer.elapsed_ns();
+    benchmark::report("pool_growth", name + " upstream allocations", stat.allocs_count(), "calls");
+    benchmark::report("pool_growth", name + " allocate", elapsed_ns / OBJS_NUM, "ns/alloc");
+    benchmark::report("pool_growth", name + " unused capacity", alloc.capacity() - OBJS_NUM, "objects");
+
+    timer.reset();
+    for (node* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+    benchmark::report("pool_growth", name + " deallocate", timer.elapsed_ns() / OBJS_NUM, "ns/free");
+}
+
+}
+
+// compares growth strategies of the pool on a pool of a few million objects
+
+BENCHMARK(pool_growth)
+{
+    run_growth<fixed_pool_growth>("fixed");
+    run_growth<geometric_pool_growth<>>("geometric");
+    run_growth<demand_pool_growth<>>("demand");
+}
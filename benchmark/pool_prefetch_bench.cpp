@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct object
+{
+    std::uint64_t data[8];
+};
+
+template <bool ENABLED>
+struct prefetch_pool_traits: public default_pool_traits
+{
+    static const bool PREFETCH = ENABLED;
+};
+
+template <bool ENABLED>
+using object_allocator = basic_pool_allocation_policy<object, allocation_traits<object>, prefetch_pool_traits<ENABLED>>;
+
+// frees a random half of a large pool and measures allocations taking the scattered objects back,
+// each allocated object is written by the caller as a new object would be constructed,
+// and the caller does work_num steps of computation between allocations
+
+template <bool ENABLED>
+void churn(const std::string& name, size_t work_num)
+{
+    const size_t OBJS_NUM = 1 << 20;
+    const size_t ROUNDS_NUM = 8;
+
+    std::default_random_engine eng(42);
+    object_allocator<ENABLED> alloc(OBJS_NUM);
+    std::vector<object*> ptrs(OBJS_NUM);
+    for (auto& ptr: ptrs) {
+        ptr = alloc.allocate(1, nullptr);
+    }
+
+    double total_ns = 0;
+    for (size_t round = 0; round < ROUNDS_NUM; ++round) {
+        std::shuffle(ptrs.begin(), ptrs.end(), eng);
+        for (size_t i = 0; i < OBJS_NUM / 2; ++i) {
+            alloc.deallocate(ptrs[i], 1);
+        }
+        benchmark::timer timer;
+        for (size_t i = 0; i < OBJS_NUM / 2; ++i) {
+            object* ptr = alloc.allocate(1, nullptr);
+            std::uint64_t value = i;
+            for (size_t j = 0; j < work_num; ++j) {
+                value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+            std::fill(ptr->data, ptr->data + 8, value);
+            ptrs[i] = ptr;
+        }
+        total_ns += timer.elapsed_ns();
+    }
+    benchmark::report("pool_prefetch_churn", name + ",work=" + std::to_string(work_num), total_ns / (ROUNDS_NUM * OBJS_NUM / 2), "ns/alloc");
+
+    for (object* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+}
+
+}
+
+// measures latency of allocations from free lists scattered by churn with and without prefetch
+
+BENCHMARK(pool_prefetch_churn)
+{
+    for (size_t work_num: {0, 16, 64}) {
+        churn<false>("prefetch=false", work_num);
+        churn<true>("prefetch=true", work_num);
+    }
+}
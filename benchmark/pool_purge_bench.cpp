@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload;
+};
+
+typedef pool_allocation_policy<node> node_allocator;
+
+}
+
+// measures resident memory of a pool after a spike of allocations is freed
+// and after the idle memory is purged, and the time of the purge pass
+
+BENCHMARK(pool_purge_rss)
+{
+    const size_t BLOCK_SIZE = 1 << 16;
+    const size_t OBJS_NUM = 1 << 22;
+
+    node_allocator alloc(BLOCK_SIZE);
+    std::vector<node*> ptrs;
+    ptrs.reserve(OBJS_NUM);
+    size_t rss_before = benchmark::rss_bytes();
+
+    alloc.allocate_batch(OBJS_NUM, std::back_inserter(ptrs));
+    for (node* ptr: ptrs) {
+        ptr->payload = 42;
+    }
+    // a small part of objects survives the spike
+    size_t live = OBJS_NUM / 100;
+    alloc.deallocate_batch(ptrs.begin() + live, ptrs.end());
+    benchmark::report("pool_purge_rss", "after spike",
+                      (benchmark::rss_bytes() - rss_before) / 1048576.0, "MiB");
+
+    // the first pass only marks chunks idle
+    alloc.purge(std::chrono::milliseconds(1));
+    benchmark::timer timer;
+    alloc.purge(std::chrono::milliseconds(0));
+    benchmark::report("pool_purge_rss", "purge pass", timer.elapsed_ns() / 1000.0, "us");
+    benchmark::report("pool_purge_rss", "after purge",
+                      (benchmark::rss_bytes() - rss_before) / 1048576.0, "MiB");
+
+    timer.reset();
+    alloc.purge(std::chrono::milliseconds(0));
+    benchmark::report("pool_purge_rss", "purge pass, nothing to purge", timer.elapsed_ns() / 1000.0, "us");
+
+    alloc.deallocate_batch(ptrs.begin(), ptrs.begin() + live);
+}
@@ -0,0 +1,105 @@
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+template <int N>
+struct object
+{
+    char data[N];
+};
+
+typedef pool_allocation_policy<object<1>> base_allocator;
+
+// keeps alive rebinded copies of allocator for objects of sizes 1..N,
+// so pools manager has N pools during the benchmark
+
+template <int N>
+struct pools_holder
+{
+    explicit pools_holder(const base_allocator& alloc):
+        m_alloc(alloc)
+      , m_tail(alloc)
+    {}
+
+    typename base_allocator::template rebind<object<N>> m_alloc;
+    pools_holder<N - 1> m_tail;
+};
+
+template <>
+struct pools_holder<0>
+{
+    explicit pools_holder(const base_allocator&)
+    {}
+};
+
+}
+
+// measures copy, rebind and destruction of pool allocation policy
+// as done by containers like std::list or std::map
+
+BENCHMARK(pool_copy_rebind_destroy)
+{
+    const size_t ITER_NUM = 1 << 20;
+
+    base_allocator alloc;
+    pools_holder<48> holder(alloc);
+
+    benchmark::timer timer;
+    for (size_t i = 0; i < ITER_NUM; ++i) {
+        base_allocator copy(alloc);
+        base_allocator::rebind<object<24>> node_alloc(copy);
+        base_allocator::rebind<object<40>> other_node_alloc(node_alloc);
+        benchmark::do_not_optimize(other_node_alloc);
+    }
+    benchmark::report("pool_copy_rebind_destroy", "pools=48",
+                      timer.elapsed_ns() / ITER_NUM, "ns/(copy+2 rebinds+3 destroys)");
+}
+
+// measures deallocation of objects through allocator rebinded to another type,
+// i.e. when the pointer is owned by the pool of other size (like std::list does with its nodes)
+
+BENCHMARK(pool_cross_size_dealloc)
+{
+    const size_t OBJ_NUM = 1 << 16;
+    const size_t ITER_NUM = 1 << 4;
+
+    base_allocator alloc;
+    pools_holder<48> holder(alloc);
+    base_allocator::rebind<object<24>> node_alloc(alloc);
+    std::vector<object<24>*> ptrs(OBJ_NUM);
+
+    double same_ns = 0;
+    double cross_ns = 0;
+    for (size_t i = 0; i < ITER_NUM; ++i) {
+        for (auto& ptr: ptrs) {
+            ptr = node_alloc.allocate(1, nullptr);
+        }
+        benchmark::timer same_timer;
+        for (auto ptr: ptrs) {
+            node_alloc.deallocate(ptr, 1);
+        }
+        same_ns += same_timer.elapsed_ns();
+
+        for (auto& ptr: ptrs) {
+            ptr = node_alloc.allocate(1, nullptr);
+        }
+        benchmark::timer cross_timer;
+        for (auto ptr: ptrs) {
+            alloc.deallocate(reinterpret_cast<object<1>*>(ptr), 1);
+        }
+        cross_ns += cross_timer.elapsed_ns();
+    }
+    benchmark::report("pool_cross_size_dealloc", "pools=48,owner=same",
+                      same_ns / (OBJ_NUM * ITER_NUM), "ns/free");
+    benchmark::report("pool_cross_size_dealloc", "pools=48,owner=other",
+                      cross_ns / (OBJ_NUM * ITER_NUM), "ns/free");
+}
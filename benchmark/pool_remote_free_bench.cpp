@@ -0,0 +1,120 @@
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct message
+{
+    std::uint64_t data[6];
+};
+
+struct locked_pool_traits: public default_pool_traits
+{
+    typedef std::mutex mutex_type;
+};
+
+struct remote_free_pool_traits: public default_pool_traits
+{
+    typedef std::mutex mutex_type;
+    static const bool REMOTE_FREE = true;
+};
+
+typedef basic_pool_allocation_policy<message, allocation_traits<message>, locked_pool_traits> locked_allocator;
+typedef basic_pool_allocation_policy<message, allocation_traits<message>, remote_free_pool_traits> remote_free_allocator;
+typedef default_allocation_policy<message> new_allocator;
+
+// single producer single consumer ring of messages
+
+class spsc_queue
+{
+public:
+
+    static const size_t CAPACITY = 1024;
+
+    spsc_queue():
+        m_slots(CAPACITY)
+      , m_head(0)
+      , m_tail(0)
+    {}
+
+    bool push(message* msg)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == CAPACITY) {
+            return false;
+        }
+        m_slots[tail % CAPACITY] = msg;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    message* pop()
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        message* msg = m_slots[head % CAPACITY];
+        m_head.store(head + 1, std::memory_order_release);
+        return msg;
+    }
+
+private:
+    std::vector<message*> m_slots;
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
+
+template <typename alloc_type>
+void producer_consumer(const char* alloc_name)
+{
+    const size_t MSG_NUM = 1 << 22;
+
+    alloc_type alloc;
+    spsc_queue queue;
+
+    benchmark::timer timer;
+    std::thread consumer([alloc, &queue] () mutable {
+        for (size_t i = 0; i < MSG_NUM; ++i) {
+            message* msg = nullptr;
+            while (!(msg = queue.pop())) {
+                std::this_thread::yield();
+            }
+            benchmark::do_not_optimize(msg->data[0]);
+            alloc.deallocate(msg, 1);
+        }
+    });
+    for (size_t i = 0; i < MSG_NUM; ++i) {
+        message* msg = alloc.allocate(1, nullptr);
+        msg->data[0] = i;
+        while (!queue.push(msg)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    benchmark::report("pool_producer_consumer", std::string("alloc=") + alloc_name,
+                      timer.elapsed_ns() / MSG_NUM, "ns/msg");
+}
+
+}
+
+// measures messages allocated by one thread and deallocated by another
+
+BENCHMARK(pool_producer_consumer)
+{
+    producer_consumer<remote_free_allocator>("remote_free_pool");
+    producer_consumer<locked_allocator>("locked_pool");
+    producer_consumer<new_allocator>("new");
+}
@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <string>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct node
+{
+    node* next;
+    std::uint64_t payload;
+};
+
+typedef pool_allocation_policy<node> node_allocator;
+
+}
+
+// measures time of large reserve and growth of resident memory as objects are allocated
+
+BENCHMARK(pool_reserve)
+{
+    const size_t CAPACITY = 10000000;
+
+    node_allocator alloc;
+    size_t rss_before = benchmark::rss_bytes();
+
+    benchmark::timer timer;
+    alloc.reserve(CAPACITY);
+    benchmark::report("pool_reserve", "capacity=" + std::to_string(CAPACITY), timer.elapsed_ns() / 1000, "us");
+    benchmark::report("pool_reserve", "rss growth after reserve",
+                      (benchmark::rss_bytes() - rss_before) / 1048576.0, "MiB");
+
+    size_t allocated = 0;
+    for (size_t used: {CAPACITY / 100, CAPACITY / 10, CAPACITY}) {
+        for (; allocated < used; ++allocated) {
+            node* ptr = alloc.allocate(1, nullptr);
+            ptr->payload = allocated;
+        }
+        benchmark::report("pool_reserve", "rss growth with " + std::to_string(used) + " objects",
+                          (benchmark::rss_bytes() - rss_before) / 1048576.0, "MiB");
+    }
+}
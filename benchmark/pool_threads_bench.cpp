@@ -0,0 +1,86 @@
+#include <cstddef>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+#include "alloc_policies.hpp"
+#include "pool_allocation.hpp"
+
+using namespace alloc_utility;
+
+namespace
+{
+
+struct object
+{
+    std::uint64_t data[4];
+};
+
+struct cached_pool_traits: public default_pool_traits
+{
+    typedef std::mutex mutex_type;
+    static const std::size_t THREAD_CACHE_SIZE = 64;
+};
+
+typedef basic_pool_allocation_policy<object, allocation_traits<object>, cached_pool_traits> cached_allocator;
+typedef default_allocation_policy<object> new_allocator;
+
+// Larson-style workload: each thread keeps an array of live objects
+// and repeatedly replaces a random one of them with a new object
+
+template <typename alloc_type>
+void larson_thread(alloc_type alloc, size_t ops_num, unsigned seed)
+{
+    const size_t LIVE_NUM = 1000;
+
+    std::minstd_rand eng(seed);
+    std::vector<object*> live(LIVE_NUM);
+    for (auto& ptr: live) {
+        ptr = alloc.allocate(1, nullptr);
+    }
+    for (size_t i = 0; i < ops_num; ++i) {
+        object*& ptr = live[eng() % LIVE_NUM];
+        alloc.deallocate(ptr, 1);
+        ptr = alloc.allocate(1, nullptr);
+        ptr->data[0] = i;
+    }
+    for (auto& ptr: live) {
+        alloc.deallocate(ptr, 1);
+    }
+}
+
+template <typename alloc_type>
+void larson(const char* alloc_name)
+{
+    const size_t OPS_NUM = 1 << 20;
+
+    for (size_t threads_num: {1, 2, 4, 8, 16, 32}) {
+        alloc_type alloc;
+        std::vector<std::thread> threads;
+        benchmark::timer timer;
+        for (size_t i = 0; i < threads_num; ++i) {
+            threads.emplace_back(larson_thread<alloc_type>, alloc, OPS_NUM, static_cast<unsigned>(i + 1));
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        double ops_per_sec = threads_num * OPS_NUM / (timer.elapsed_ns() * 1e-9);
+        benchmark::report("pool_threads_larson",
+                          std::string("alloc=") + alloc_name + ",threads=" + std::to_string(threads_num),
+                          ops_per_sec * 1e-6, "Mops/s");
+    }
+}
+
+}
+
+// measures throughput of alloc/free pairs depending on the number of threads
+
+BENCHMARK(pool_threads_larson)
+{
+    larson<cached_allocator>("cached_pool");
+    larson<new_allocator>("new");
+}
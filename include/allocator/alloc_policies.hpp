@@ -1,6 +1,9 @@
 #ifndef ALLOC_POLICIES_H
 #define ALLOC_POLICIES_H
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <new>
 
@@ -11,6 +14,9 @@
 namespace alloc_utility
 {
 
+// size of cache line assumed by policies which isolate objects from each other
+const std::size_t CACHE_LINE_SIZE = 64;
+
 template <typename T, typename alloc_traits = allocation_traits<T>,
           typename base_policy = none_policy<T, alloc_traits>>
 class default_allocation_policy: public base_policy
@@ -47,6 +53,96 @@ public:
     }
 };
 
+// aligned_allocation_policy allocates memory aligned by the largest of alignof(T) and the alignment
+// of the policy, which may exceed the alignment guaranteed by operator new.
+// Memory is cut from a larger block of operator new, the pointer to the block is kept
+// right before the returned memory, so it's released whatever the alignment of the releasing copy is.
+// Rebinded copies inherit the alignment of the policy
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = none_policy<T, alloc_traits>>
+class aligned_allocation_policy: public base_policy
+{
+public:
+
+    DECLARE_ALLOC_TRAITS(T, alloc_traits)
+    DECLARE_REBIND_ALLOC(aligned_allocation_policy, T, alloc_traits, base_policy)
+
+    // alignment should be a power of 2
+
+    explicit aligned_allocation_policy(size_type alignment = 1) noexcept:
+        m_alignment(1)
+    {
+        set_alignment(alignment);
+    }
+
+    template <typename U>
+    aligned_allocation_policy(const rebind<U>& other):
+        base_policy(other)
+      , m_alignment(other.m_alignment)
+    {}
+
+    size_type alignment() const noexcept
+    {
+        return m_alignment > alignof(T) ? m_alignment : alignof(T);
+    }
+
+    void set_alignment(size_type alignment) noexcept
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+        m_alignment = alignment;
+    }
+
+    pointer allocate(size_type n, const pointer& ptr, const_void_pointer hint = nullptr)
+    {
+        pointer res = ptr;
+        if (!ptr) {
+            res = static_cast<pointer>(aligned_new(n * sizeof(value_type)));
+        }
+        return base_policy::allocate(n, res, hint);
+    }
+
+    void deallocate(const pointer& ptr, size_type n)
+    {
+        if (ptr) {
+            aligned_delete(static_cast<void*>(ptr));
+            base_policy::deallocate(ptr, n);
+        }
+    }
+
+    template <typename, typename, typename>
+    friend class aligned_allocation_policy;
+
+private:
+
+    static const size_type NEW_ALIGNMENT = alignof(std::max_align_t);
+
+    // operator new aligns by NEW_ALIGNMENT, so at most align bytes precede aligned memory
+
+    void* aligned_new(size_type size) const noexcept
+    {
+        size_type align = alignment() > NEW_ALIGNMENT ? alignment() : NEW_ALIGNMENT;
+        void* mem = ::operator new(size + align, std::nothrow);
+        if (!mem) {
+            return nullptr;
+        }
+        std::uintptr_t addr = (reinterpret_cast<std::uintptr_t>(mem) + sizeof(void*) + align - 1)
+                                & ~static_cast<std::uintptr_t>(align - 1);
+        reinterpret_cast<void**>(addr)[-1] = mem;
+        return reinterpret_cast<void*>(addr);
+    }
+
+    static void aligned_delete(void* ptr) noexcept
+    {
+        ::operator delete(static_cast<void**>(ptr)[-1]);
+    }
+
+    size_type m_alignment;
+};
+
+template <typename T, typename alloc_traits, typename base_policy>
+const typename alloc_traits::size_type aligned_allocation_policy<T, alloc_traits, base_policy>::NEW_ALIGNMENT;
+
 template <typename T, typename alloc_traits = allocation_traits<T>,
           typename base_policy = none_policy<T, alloc_traits>>
 class throw_bad_alloc_policy: public base_policy
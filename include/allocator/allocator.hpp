@@ -83,6 +83,23 @@ public:
         base::deallocate(ptr, n);
     }
 
+    // allocates n single objects writing pointers to them into out,
+    // returns out past the last written pointer
+
+    template <typename OutputIt>
+    OutputIt allocate_batch(size_type n, OutputIt out)
+    {
+        return base::allocate_batch(n, out);
+    }
+
+    // deallocates single objects pointed by [first, last)
+
+    template <typename InputIt>
+    void deallocate_batch(InputIt first, InputIt last)
+    {
+        base::deallocate_batch(first, last);
+    }
+
     size_type max_size() const noexcept
     {
         return alloc_traits::max_size();
@@ -250,6 +250,22 @@ struct supports_sub_assign<
         >
 {};
 
+// checks that allocation policy T provides allocate_batch(n, out) and deallocate_batch(first, last)
+
+template <typename T, typename = void>
+struct supports_batch_allocation: public std::false_type
+{};
+
+template <typename T>
+struct supports_batch_allocation<T, void_t<
+            decltype(std::declval<T&>().allocate_batch(std::declval<typename T::size_type>(),
+                                                       std::declval<typename T::pointer*>())),
+            decltype(std::declval<T&>().deallocate_batch(std::declval<typename T::pointer*>(),
+                                                         std::declval<typename T::pointer*>()))
+        >
+    >: public std::true_type
+{};
+
 /* *****************************************************************************************************
    is_
    ***************************************************************************************************** */
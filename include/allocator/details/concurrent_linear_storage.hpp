@@ -0,0 +1,243 @@
+#ifndef CONCURRENT_LINEAR_STORAGE_HPP
+#define CONCURRENT_LINEAR_STORAGE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// concurrent_linear_storage has the interface of linear_storage, but allocations, free_last and try_resize
+// may be called from different threads at the same time: the offset of free memory is advanced by
+// compare-and-swap, so a request which doesn't fit leaves the storage unchanged and smaller requests
+// may still succeed. set_storage, rewind and purge should not run concurrently with other calls.
+// Memory orders are relaxed: the storage only hands out disjoint ranges, publishing objects built in them
+// is up to the user
+
+template <typename pointer, typename size_type>
+class concurrent_linear_storage
+{
+public:
+
+    static_assert(std::is_same<typename std::pointer_traits<pointer>::element_type, std::uint8_t>::value,
+                  "Type of pointed value should be uint8_t");
+
+    concurrent_linear_storage() noexcept:
+        m_storage(nullptr)
+      , m_storage_size(0)
+      , m_offset(0)
+      , m_dirty_end(0)
+      , m_purgeable(false)
+      , m_idle_offset(0)
+      , m_idle_since(NOT_IDLE)
+      , m_generation(0)
+    {}
+
+    concurrent_linear_storage(const concurrent_linear_storage&) = delete;
+    concurrent_linear_storage& operator=(const concurrent_linear_storage&) = delete;
+
+    size_type storage_size() const noexcept
+    {
+        return m_storage_size;
+    }
+
+    // the result may be outdated as soon as it is returned if other threads allocate, use try_allocate
+
+    bool is_memory_available(size_type mem_size, size_type alignment = 1) const noexcept
+    {
+        return fits(m_offset.load(std::memory_order_relaxed), mem_size, alignment);
+    }
+
+    bool is_owned(const pointer& ptr) const noexcept
+    {
+        return m_storage && (m_storage <= ptr) && (ptr < m_storage + m_storage_size);
+    }
+
+    pointer get_storage() const noexcept
+    {
+        return m_storage;
+    }
+
+    // it changes when memory handed out before may be allocated again (by set_storage or rewind),
+    // so buffers carved from the storage (see tlab_cache) know they are outdated
+
+    std::uint64_t generation() const noexcept
+    {
+        return m_generation.load(std::memory_order_relaxed);
+    }
+
+    // see linear_storage::set_storage
+
+    void set_storage(const pointer& storage, size_type size, bool purgeable = true) noexcept
+    {
+        size_type offset = m_offset.load(std::memory_order_relaxed);
+        size_type dirty_end = m_dirty_end.load(std::memory_order_relaxed);
+        // contents of new storage is unknown, so it is treated as used entirely
+        dirty_end = (storage == m_storage) ? std::max(dirty_end, offset) : size;
+        m_dirty_end.store(std::min(dirty_end, size), std::memory_order_relaxed);
+        m_purgeable = purgeable || (storage == m_storage && m_purgeable);
+        m_storage = storage;
+        m_storage_size = size;
+        m_offset.store(0, std::memory_order_relaxed);
+        m_idle_since = NOT_IDLE;
+        m_generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the storage should have enough memory, it is intended for a single thread (see try_allocate)
+
+    pointer allocate(size_type size, size_type alignment = 1) noexcept
+    {
+        pointer ptr = try_allocate(size, alignment);
+        assert(ptr);
+        return ptr;
+    }
+
+    // returns nullptr if there is not enough memory
+
+    pointer try_allocate(size_type size, size_type alignment = 1) noexcept
+    {
+        size_type offset = m_offset.load(std::memory_order_relaxed);
+        size_type start = 0;
+        do {
+            if (!fits(offset, size, alignment)) {
+                return nullptr;
+            }
+            start = offset + padding(offset, alignment);
+        } while (!m_offset.compare_exchange_weak(offset, start + size, std::memory_order_relaxed));
+        return m_storage + start;
+    }
+
+    size_type get_marker() const noexcept
+    {
+        return m_offset.load(std::memory_order_relaxed);
+    }
+
+    void rewind(size_type marker) noexcept
+    {
+        size_type offset = m_offset.load(std::memory_order_relaxed);
+        if (marker < offset) {
+            update_dirty_end(offset);
+            m_offset.store(marker, std::memory_order_relaxed);
+            m_generation.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool is_last(const pointer& ptr, size_type size) const noexcept
+    {
+        return is_owned(ptr) && (ptr + size == m_storage + m_offset.load(std::memory_order_relaxed));
+    }
+
+    // succeeds only if no other thread allocated after the memory
+
+    bool free_last(const pointer& ptr, size_type size) noexcept
+    {
+        if (!is_owned(ptr)) {
+            return false;
+        }
+        size_type offset = static_cast<size_type>(ptr - m_storage);
+        return exchange_offset(offset + size, offset);
+    }
+
+    bool try_resize(const pointer& ptr, size_type old_size, size_type new_size) noexcept
+    {
+        if (!is_owned(ptr)) {
+            return false;
+        }
+        size_type offset = static_cast<size_type>(ptr - m_storage);
+        if (new_size > m_storage_size - offset) {
+            return false;
+        }
+        return exchange_offset(offset + old_size, offset + new_size);
+    }
+
+    // see linear_storage::purge
+
+    template <typename Purge>
+    size_type purge(std::uint32_t now, std::uint32_t decay, Purge&& purge)
+    {
+        size_type offset = m_offset.load(std::memory_order_relaxed);
+        update_dirty_end(offset);
+        size_type dirty_end = m_dirty_end.load(std::memory_order_relaxed);
+        if (!m_storage || !m_purgeable || dirty_end <= offset) {
+            return 0;
+        }
+        if (m_idle_since == NOT_IDLE || m_idle_offset != offset) {
+            m_idle_offset = offset;
+            m_idle_since = (now == NOT_IDLE) ? now - 1 : now;
+        }
+        if (static_cast<std::uint32_t>(now - m_idle_since) < decay) {
+            return 0;
+        }
+        size_type purged = purge(m_storage + offset, dirty_end - offset);
+        m_dirty_end.store(offset, std::memory_order_relaxed);
+        m_idle_since = NOT_IDLE;
+        return purged;
+    }
+
+private:
+
+    bool fits(size_type offset, size_type mem_size, size_type alignment) const noexcept
+    {
+        if (!m_storage || (mem_size > m_storage_size) || (offset > m_storage_size - mem_size)) {
+            return false;
+        }
+        return padding(offset, alignment) <= m_storage_size - mem_size - offset;
+    }
+
+    size_type padding(size_type offset, size_type alignment) const noexcept
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+        std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(&*m_storage) + offset;
+        return static_cast<size_type>((alignment - (addr & (alignment - 1))) & (alignment - 1));
+    }
+
+    // moves the offset from expected to desired if no other thread moved it
+
+    bool exchange_offset(size_type expected, size_type desired) noexcept
+    {
+        size_type offset = expected;
+        if (!m_offset.compare_exchange_strong(offset, desired, std::memory_order_relaxed)) {
+            return false;
+        }
+        if (desired < expected) {
+            update_dirty_end(expected);
+        }
+        return true;
+    }
+
+    void update_dirty_end(size_type offset) noexcept
+    {
+        size_type dirty_end = m_dirty_end.load(std::memory_order_relaxed);
+        while (dirty_end < offset &&
+               !m_dirty_end.compare_exchange_weak(dirty_end, offset, std::memory_order_relaxed))
+        {}
+    }
+
+    static const std::uint32_t NOT_IDLE = std::numeric_limits<std::uint32_t>::max();
+
+    pointer m_storage;
+    size_type m_storage_size;
+    std::atomic<size_type> m_offset;
+    // memory after m_dirty_end was never used since it was purged
+    std::atomic<size_type> m_dirty_end;
+    bool m_purgeable;
+    size_type m_idle_offset;
+    std::uint32_t m_idle_since;
+    std::atomic<std::uint64_t> m_generation;
+};
+
+template <typename pointer, typename size_type>
+const std::uint32_t concurrent_linear_storage<pointer, size_type>::NOT_IDLE;
+
+} // namespace details
+
+} // namespace alloc_utility
+
+#endif // CONCURRENT_LINEAR_STORAGE_HPP
@@ -0,0 +1,130 @@
+#ifndef LINEAR_ARENA_HPP
+#define LINEAR_ARENA_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "linear_storage.hpp"
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// linear_arena bump allocates from a chain of memory regions supplied by the user.
+// Only the last added region is allocated from, the previous ones are kept until release().
+// Regions are indexed by their addresses, so ownership of a pointer is checked
+// by a binary search (after the check of the current region).
+
+template <typename pointer, typename size_type>
+class linear_arena
+{
+public:
+
+    static_assert(std::is_same<typename std::pointer_traits<pointer>::element_type, std::uint8_t>::value,
+                  "Type of pointed value should be uint8_t");
+
+    linear_arena() noexcept:
+        m_total_size(0)
+    {}
+
+    linear_arena(const linear_arena&) = delete;
+    linear_arena& operator=(const linear_arena&) = delete;
+
+    size_type regions_count() const noexcept
+    {
+        return m_regions.size();
+    }
+
+    // total size of all regions in bytes
+
+    size_type total_size() const noexcept
+    {
+        return m_total_size;
+    }
+
+    bool is_memory_available(size_type mem_size, size_type alignment = 1) const noexcept
+    {
+        return m_current.is_memory_available(mem_size, alignment);
+    }
+
+    bool is_owned(const pointer& ptr) const noexcept
+    {
+        if (m_current.is_owned(ptr)) {
+            return true;
+        }
+        auto it = std::upper_bound(m_index.begin(), m_index.end(), ptr,
+                                   [](const pointer& p, const region& r) { return p < r.mem; });
+        return it != m_index.begin() && ptr < (it - 1)->mem + (it - 1)->size;
+    }
+
+    // allocates from the current region which should have enough memory (see is_memory_available)
+
+    pointer allocate(size_type size, size_type alignment = 1) noexcept
+    {
+        return m_current.allocate(size, alignment);
+    }
+
+    // only the last allocation from the current region can be freed or resized (see linear_storage)
+
+    bool free_last(const pointer& ptr, size_type size) noexcept
+    {
+        return m_current.free_last(ptr, size);
+    }
+
+    bool try_resize(const pointer& ptr, size_type old_size, size_type new_size) noexcept
+    {
+        return m_current.try_resize(ptr, old_size, new_size);
+    }
+
+    // makes the region current, the rest of the previous current region is not used anymore
+
+    void add_region(const pointer& mem, size_type size)
+    {
+        m_regions.push_back(region{mem, size});
+        auto pos = std::upper_bound(m_index.begin(), m_index.end(), mem,
+                                    [](const pointer& p, const region& r) { return p < r.mem; });
+        m_index.insert(pos, region{mem, size});
+        m_current.set_storage(mem, size);
+        m_total_size += size;
+    }
+
+    // calls release(mem, size) for every region in the order they were added and forgets them
+
+    template <typename Release>
+    void release(Release&& release)
+    {
+        for (const region& r: m_regions) {
+            release(r.mem, r.size);
+        }
+        m_regions.clear();
+        m_index.clear();
+        m_current = linear_storage<pointer, size_type>();
+        m_total_size = 0;
+    }
+
+private:
+
+    struct region
+    {
+        pointer mem;
+        size_type size;
+    };
+
+    linear_storage<pointer, size_type> m_current;
+    // regions in the order they were added
+    std::vector<region> m_regions;
+    // regions sorted by address
+    std::vector<region> m_index;
+    size_type m_total_size;
+};
+
+} // namespace details
+
+} // namespace alloc_utility
+
+#endif // LINEAR_ARENA_HPP
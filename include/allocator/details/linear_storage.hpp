@@ -1,6 +1,10 @@
 #ifndef LINEAR_STORAGE_HPP
 #define LINEAR_STORAGE_HPP
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
 #include <type_traits>
 
 namespace alloc_utility
@@ -21,6 +25,10 @@ public:
         m_storage(nullptr)
       , m_storage_size(0)
       , m_offset(0)
+      , m_dirty_end(0)
+      , m_purgeable(false)
+      , m_idle_offset(0)
+      , m_idle_since(NOT_IDLE)
     {}
 
     size_type storage_size() const noexcept
@@ -28,9 +36,15 @@ public:
         return m_storage_size;
     }
 
-    bool is_memory_available(size_type mem_size) const noexcept
+    // alignment should be a power of 2, it is relative to the address of memory rather than to the storage,
+    // so the storage itself may be aligned arbitrarily
+
+    bool is_memory_available(size_type mem_size, size_type alignment = 1) const noexcept
     {
-        return m_storage && (mem_size <= m_storage_size) && (m_offset <= m_storage_size - mem_size);
+        if (!m_storage || (mem_size > m_storage_size) || (m_offset > m_storage_size - mem_size)) {
+            return false;
+        }
+        return padding(alignment) <= m_storage_size - mem_size - m_offset;
     }
 
     bool is_owned(const pointer& ptr) const noexcept
@@ -43,26 +57,144 @@ public:
         return m_storage;
     }
 
-    void set_storage(const pointer& storage, size_type size) noexcept
+    // setting the same storage again makes all its memory available for allocations.
+    // Only purgeable storage is purged, it should be private anonymous memory (i.e. from mmap or malloc),
+    // memory on the stack, static or file backed memory shouldn't be purgeable. The same storage stays purgeable
+
+    void set_storage(const pointer& storage, size_type size, bool purgeable = true) noexcept
     {
+        // contents of new storage is unknown, so it is treated as used entirely
+        m_dirty_end = (storage == m_storage) ? std::max(m_dirty_end, m_offset) : size;
+        m_dirty_end = std::min(m_dirty_end, size);
+        m_purgeable = purgeable || (storage == m_storage && m_purgeable);
         m_storage = storage;
         m_storage_size = size;
         m_offset = 0;
+        m_idle_since = NOT_IDLE;
     }
 
-    pointer allocate(size_type size) noexcept
+    // only the padding required by alignment is skipped before the allocated memory
+
+    pointer allocate(size_type size, size_type alignment = 1) noexcept
     {
+        m_offset += padding(alignment);
         pointer ptr = m_storage + m_offset;
         m_offset += size;
         return ptr;
     }
 
+    // returns nullptr if there is not enough memory
+
+    pointer try_allocate(size_type size, size_type alignment = 1) noexcept
+    {
+        return is_memory_available(size, alignment) ? allocate(size, alignment) : nullptr;
+    }
+
+    // marker is the offset of free memory, allocations made after the marker was taken
+    // are discarded by rewind(marker) at once. Markers should be rewound in LIFO order
+    // and are invalidated by set_storage. If the memory before the marker was freed by free_last
+    // rewind does nothing
+
+    size_type get_marker() const noexcept
+    {
+        return m_offset;
+    }
+
+    void rewind(size_type marker) noexcept
+    {
+        if (marker < m_offset) {
+            m_dirty_end = std::max(m_dirty_end, m_offset);
+            m_offset = marker;
+        }
+    }
+
+    // returns true if the memory is the last allocation from the storage
+
+    bool is_last(const pointer& ptr, size_type size) const noexcept
+    {
+        return is_owned(ptr) && (ptr + size == m_storage + m_offset);
+    }
+
+    // frees the memory if it is the last allocation, so it can be allocated again
+
+    bool free_last(const pointer& ptr, size_type size) noexcept
+    {
+        if (!is_last(ptr, size)) {
+            return false;
+        }
+        rewind(static_cast<size_type>(ptr - m_storage));
+        return true;
+    }
+
+    // changes the size of the last allocation in place, returns false if the memory isn't the last allocation
+    // or there is not enough memory in the storage
+
+    bool try_resize(const pointer& ptr, size_type old_size, size_type new_size) noexcept
+    {
+        if (!is_last(ptr, old_size)) {
+            return false;
+        }
+        size_type offset = static_cast<size_type>(ptr - m_storage);
+        if (new_size > m_storage_size - offset) {
+            return false;
+        }
+        m_dirty_end = std::max(m_dirty_end, m_offset);
+        m_offset = offset + new_size;
+        return true;
+    }
+
+    // discards memory of the free tail of the storage which was used before (and wasn't purged since),
+    // if there were no allocations during decay time units. now is the current time (i.e. details::purge_clock()).
+    // The time is counted from the first call which finds such tail, so the method should be called periodically.
+    // purge(mem, size) should release physical memory of the range (i.e. by details::purge_pages)
+    // and return the number of released bytes, which is also returned by the method
+
+    template <typename Purge>
+    size_type purge(std::uint32_t now, std::uint32_t decay, Purge&& purge)
+    {
+        m_dirty_end = std::max(m_dirty_end, m_offset);
+        if (!m_storage || !m_purgeable || m_dirty_end == m_offset) {
+            return 0;
+        }
+        if (m_idle_since == NOT_IDLE || m_idle_offset != m_offset) {
+            m_idle_offset = m_offset;
+            m_idle_since = (now == NOT_IDLE) ? now - 1 : now;
+        }
+        if (static_cast<std::uint32_t>(now - m_idle_since) < decay) {
+            return 0;
+        }
+        size_type purged = purge(m_storage + m_offset, m_dirty_end - m_offset);
+        m_dirty_end = m_offset;
+        m_idle_since = NOT_IDLE;
+        return purged;
+    }
+
 private:
+
+    // number of bytes between the free memory and the next address aligned by alignment
+
+    size_type padding(size_type alignment) const noexcept
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+        std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(&*m_storage) + m_offset;
+        return static_cast<size_type>((alignment - (addr & (alignment - 1))) & (alignment - 1));
+    }
+
+    static const std::uint32_t NOT_IDLE = std::numeric_limits<std::uint32_t>::max();
+
     pointer m_storage;
     size_type m_storage_size;
     size_type m_offset;
+    // memory after m_dirty_end was never used since it was purged
+    size_type m_dirty_end;
+    bool m_purgeable;
+    size_type m_idle_offset;
+    std::uint32_t m_idle_since;
 };
 
+template <typename pointer, typename size_type>
+const std::uint32_t linear_storage<pointer, size_type>::NOT_IDLE;
+
 } // namespace details
 
 } // namespace alloc_utility
@@ -0,0 +1,156 @@
+#ifndef LOCKFREE_STACK_HPP
+#define LOCKFREE_STACK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// Treiber stack of free memory blocks.
+// Each block in the stack stores a pointer to the next one in its first bytes,
+// so blocks should be at least sizeof(void*) bytes and suitably aligned.
+// The head of the stack is paired with a tag which is incremented on every pop,
+// so a block popped and pushed back between the read of the head and the CAS doesn't confuse pop (ABA problem).
+// On x86-64 user space addresses fit into 48 bits and the tag is packed into the upper 16 bits of the head,
+// so the head is updated by ordinary 8 byte CAS. Elsewhere the head is a pair of words
+// which requires double word CAS (cmpxchg16b on 64-bit platforms, libatomic may be needed to link).
+// Blocks are never given back to the system while the stack is alive,
+// so reading the next pointer of a block concurrently popped by another thread is safe.
+
+class lockfree_stack
+{
+    struct node
+    {
+        std::atomic<node*> next;
+    };
+
+#if defined(__x86_64__) || defined(_M_X64)
+    typedef std::uint64_t tagged_ptr;
+
+    static const int TAG_SHIFT = 48;
+
+    static tagged_ptr make_tagged(node* ptr, std::uint64_t tag) noexcept
+    {
+        return reinterpret_cast<std::uint64_t>(ptr) | (tag << TAG_SHIFT);
+    }
+
+    static node* get_ptr(tagged_ptr head) noexcept
+    {
+        return reinterpret_cast<node*>(head & ((std::uint64_t(1) << TAG_SHIFT) - 1));
+    }
+
+    static std::uint64_t get_tag(tagged_ptr head) noexcept
+    {
+        return head >> TAG_SHIFT;
+    }
+#else
+    struct tagged_ptr
+    {
+        node* ptr;
+        std::uintptr_t tag;
+    };
+
+    static tagged_ptr make_tagged(node* ptr, std::uintptr_t tag) noexcept
+    {
+        return tagged_ptr{ptr, tag};
+    }
+
+    static node* get_ptr(tagged_ptr head) noexcept
+    {
+        return head.ptr;
+    }
+
+    static std::uintptr_t get_tag(tagged_ptr head) noexcept
+    {
+        return head.tag;
+    }
+#endif
+
+public:
+
+    // memory pushed to the stack should be at least NODE_SIZE bytes aligned by NODE_ALIGNMENT
+    static const std::size_t NODE_SIZE = sizeof(node);
+    static const std::size_t NODE_ALIGNMENT = alignof(node);
+
+    lockfree_stack() noexcept:
+        m_head(make_tagged(nullptr, 0))
+    {}
+
+    lockfree_stack(const lockfree_stack&) = delete;
+    lockfree_stack& operator=(const lockfree_stack&) = delete;
+
+    void push(void* mem) noexcept
+    {
+        node* new_node = new (mem) node;
+        tagged_ptr head = m_head.load(std::memory_order_relaxed);
+        tagged_ptr new_head;
+        do {
+            new_node->next.store(get_ptr(head), std::memory_order_relaxed);
+            new_head = make_tagged(new_node, get_tag(head));
+        } while (!m_head.compare_exchange_weak(head, new_head, std::memory_order_release,
+                                                              std::memory_order_relaxed));
+    }
+
+    // returns nullptr if the stack is empty
+
+    void* pop() noexcept
+    {
+        tagged_ptr head = m_head.load(std::memory_order_acquire);
+        while (node* top = get_ptr(head)) {
+            // the tag wraps around silently
+            tagged_ptr new_head = make_tagged(top->next.load(std::memory_order_relaxed), get_tag(head) + 1);
+            if (m_head.compare_exchange_weak(head, new_head, std::memory_order_acquire,
+                                                             std::memory_order_acquire)) {
+                return top;
+            }
+        }
+        return nullptr;
+    }
+
+    // takes all blocks from the stack at once,
+    // returns the top block of taken list (or nullptr if the stack is empty), the list is walked by next()
+
+    void* pop_all() noexcept
+    {
+        tagged_ptr head = m_head.load(std::memory_order_relaxed);
+        while (get_ptr(head)) {
+            if (m_head.compare_exchange_weak(head, make_tagged(nullptr, get_tag(head) + 1),
+                                             std::memory_order_acquire, std::memory_order_relaxed)) {
+                return get_ptr(head);
+            }
+        }
+        return nullptr;
+    }
+
+    // returns block following the given one in the list taken by pop_all()
+
+    static void* next(void* mem) noexcept
+    {
+        return static_cast<node*>(mem)->next.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept
+    {
+        return get_ptr(m_head.load(std::memory_order_relaxed)) == nullptr;
+    }
+
+    bool is_lock_free() const noexcept
+    {
+        return m_head.is_lock_free();
+    }
+
+private:
+    std::atomic<tagged_ptr> m_head;
+};
+
+}   // namespace details
+
+} // namespace alloc_utility
+
+#endif // LOCKFREE_STACK_HPP
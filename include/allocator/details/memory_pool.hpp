@@ -1,11 +1,14 @@
 #ifndef MEMORY_POOL_HPP
 #define MEMORY_POOL_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cassert>
 #include <limits>
+#include <map>
+#include <mutex>
 #include <vector>
-#include <list>
 #include <memory>
 #include <new>
 #include <type_traits>
@@ -13,6 +16,7 @@
 
 #include "pointer_cast.hpp"
 #include "macro.hpp"
+#include "lockfree_stack.hpp"
 
 namespace alloc_utility
 {
@@ -20,36 +24,58 @@ namespace alloc_utility
 namespace details
 {
 
-template <typename pointer, typename size_type>
+// hints the processor to bring the cache line of addr in for writing, does nothing on unknown compilers
+
+inline void prefetch_for_write(const void* addr) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(addr, 1, 3);
+#else
+    ALLOC_UNUSED(addr);
+#endif
+}
+
+// chunk keeps a list of free objects threaded through the objects themselves:
+// each free object stores an index of the next free one in its first sizeof(index_type) bytes.
+// Thus index_type limits the number of objects in chunk (CHUNK_MAXSIZE)
+// and objects can't be smaller than MIN_OBJ_SIZE.
+// Objects which were never allocated are not threaded into the list:
+// they are handed out by bumping m_bump, so construction of chunk doesn't touch its memory.
+
+template <typename pointer, typename size_type, typename index_type = std::uint8_t>
 class chunk
 {
 public:
 
     static_assert(std::is_same<typename std::pointer_traits<pointer>::element_type, std::uint8_t>::value,
                   "Type of pointed value should be uint8_t");
+    static_assert(std::is_unsigned<index_type>::value && sizeof(index_type) <= sizeof(size_type),
+                  "Type of index should be unsigned integer not wider than size_type");
 
-    static const int CHUNK_MAXSIZE = std::numeric_limits<std::uint8_t>::max();
+    static const size_type CHUNK_MAXSIZE = std::numeric_limits<index_type>::max();
+    static const size_type MIN_OBJ_SIZE = sizeof(index_type);
 
-    chunk(pointer ptr, size_type obj_size, std::uint8_t chunk_size = CHUNK_MAXSIZE) noexcept:
+    chunk(pointer ptr, size_type obj_size, index_type chunk_size = CHUNK_MAXSIZE) noexcept:
         m_chunk(ptr)
       , m_head(0)
+      , m_bump(0)
       , m_available(chunk_size)
       , m_size(chunk_size)
+      , m_idle_since(NOT_IDLE)
     {
+        ALLOC_UNUSED(obj_size);
         assert(ptr);
         assert(chunk_size > 0);
-        for (int i = 1; i <= chunk_size; ++i, ptr += obj_size) {
-            ptr[0] = i;
-        }
-        // last block is initialized with chunk_size
-        // it is really doesn't matter because when we reach last block m_available == 0
+        assert(obj_size >= MIN_OBJ_SIZE);
     }
 
     chunk(chunk&& other) noexcept:
         m_chunk(other.m_chunk)
       , m_head(other.m_head)
+      , m_bump(other.m_bump)
       , m_available(other.m_available)
       , m_size(other.m_size)
+      , m_idle_since(other.m_idle_since)
     {}
 
     chunk(const chunk&) = delete;
@@ -66,71 +92,176 @@ public:
         return (m_chunk <= ptr) && (ptr < m_chunk + size() * obj_size);
     }
 
-    std::uint8_t size() const noexcept
+    index_type size() const noexcept
     {
         return m_size;
     }
 
-    pointer allocate(size_type obj_size)
+    pointer get_memory_ptr() const noexcept
+    {
+        return m_chunk;
+    }
+
+    // if prefetch is true the next free object of the list is prefetched,
+    // so reading its index by the following allocation (and the use of the object by the caller)
+    // overlaps with the work done between allocations
+
+    pointer allocate(size_type obj_size, bool prefetch = false)
     {
+        m_idle_since = NOT_IDLE;
         if (is_memory_available()) {
             pointer ptr = m_chunk + (m_head * obj_size);
-            m_head = ptr[0];
+            // list of deallocated objects ends with m_bump,
+            // so when we reach it the next object is taken from never used memory
+            if (m_head == m_bump) {
+                m_head = ++m_bump;
+            } else {
+                m_head = load_index(ptr);
+                if (prefetch && m_head != m_bump) {
+                    prefetch_for_write(&*(m_chunk + m_head * obj_size));
+                }
+            }
             m_available--;
             return ptr;
         }
         return pointer(nullptr);
     }
 
+    // allocates up to n objects passing each of them to sink, returns the number of allocated objects.
+    // Never used objects are handed out as a contiguous run without reading the memory
+
+    template <typename Sink>
+    size_type allocate_batch(size_type n, size_type obj_size, Sink& sink)
+    {
+        size_type count = std::min<size_type>(n, m_available);
+        m_idle_since = NOT_IDLE;
+        for (size_type i = 0; i < count; ++i) {
+            if (m_head == m_bump) {
+                size_type run = count - i;
+                pointer ptr = m_chunk + (m_bump * obj_size);
+                for (size_type j = 0; j < run; ++j, ptr += obj_size) {
+                    sink(ptr);
+                }
+                m_bump = static_cast<index_type>(m_bump + run);
+                m_head = m_bump;
+                break;
+            }
+            pointer ptr = m_chunk + (m_head * obj_size);
+            m_head = load_index(ptr);
+            sink(ptr);
+        }
+        m_available = static_cast<index_type>(m_available - count);
+        return count;
+    }
+
     void deallocate(const pointer& ptr, size_type obj_size)
     {
-        ptr[0] = m_head;
+        store_index(ptr, m_head);
         m_head = (ptr - m_chunk) / obj_size;
         m_available++;
     }
 
+    // checks that the chunk has no allocated objects since time now - decay.
+    // The time is counted from the first check which finds the chunk empty (the chunk is marked idle),
+    // any allocation from the chunk removes the mark.
+    // Chunks which memory was never used (or was already purged) are never idle
+
+    bool check_idle(std::uint32_t now, std::uint32_t decay) noexcept
+    {
+        if (m_available != m_size || m_bump == 0) {
+            return false;
+        }
+        if (m_idle_since == NOT_IDLE) {
+            // the mark can't take the reserved value, it makes the chunk idle for one tick longer
+            m_idle_since = (now == NOT_IDLE) ? now - 1 : now;
+        }
+        return static_cast<std::uint32_t>(now - m_idle_since) >= decay;
+    }
+
+    // forgets the list of free objects of the empty chunk,
+    // so its memory is not read anymore and its contents may be discarded
+
+    void reset() noexcept
+    {
+        assert(m_available == m_size);
+        m_head = 0;
+        m_bump = 0;
+        m_idle_since = NOT_IDLE;
+    }
+
 private:
+
+    static const std::uint32_t NOT_IDLE = std::numeric_limits<std::uint32_t>::max();
+
+    // index is stored byte by byte, because objects are not necessary aligned for index_type
+
+    static void store_index(const pointer& ptr, index_type idx) noexcept
+    {
+        for (size_type i = 0; i < sizeof(index_type); ++i) {
+            ptr[i] = static_cast<std::uint8_t>(idx >> (8 * i));
+        }
+    }
+
+    static index_type load_index(const pointer& ptr) noexcept
+    {
+        index_type idx = 0;
+        for (size_type i = 0; i < sizeof(index_type); ++i) {
+            idx = static_cast<index_type>(idx | (static_cast<index_type>(ptr[i]) << (8 * i)));
+        }
+        return idx;
+    }
+
     pointer m_chunk;
-    std::uint8_t m_head;
-    std::uint8_t m_available;
-    std::uint8_t m_size;
+    index_type m_head;
+    index_type m_bump;
+    index_type m_available;
+    index_type m_size;
+    // time when the chunk was found empty, kept in the padding after indices for narrow index types
+    std::uint32_t m_idle_since;
 };
 
-template <typename pointer, typename size_type>
+template <typename pointer, typename size_type, typename index_type>
+const size_type chunk<pointer, size_type, index_type>::CHUNK_MAXSIZE;
+
+template <typename pointer, typename size_type, typename index_type>
+const std::uint32_t chunk<pointer, size_type, index_type>::NOT_IDLE;
+
+template <typename pointer, typename size_type, typename index_type>
+const size_type chunk<pointer, size_type, index_type>::MIN_OBJ_SIZE;
+
+template <typename pointer, typename size_type, typename index_type = std::uint8_t>
 class memory_block
 {
 public:
 
-    typedef chunk<pointer, size_type> chunk_type;
+    typedef chunk<pointer, size_type, index_type> chunk_type;
     typedef typename std::vector<chunk_type>::iterator chunk_it;
 
-    memory_block(pointer mem, size_type obj_size, size_type obj_num) noexcept:
+    // chunks are created lazily as allocations reach them,
+    // so adding a memory block doesn't touch the memory itself
+
+    memory_block(pointer mem, size_type obj_size, size_type obj_num):
         m_mem(mem)
       , m_size(obj_num)
+      , m_available(obj_num)
+      , m_listed_chunks(chunks_count(), false)
     {
+        ALLOC_UNUSED(obj_size);
         assert(mem);
         assert(obj_num > 0);
-        size_type chunks_num = (obj_num + chunk_type::CHUNK_MAXSIZE - 1) / chunk_type::CHUNK_MAXSIZE;
-        size_type last_chunk_size = obj_num % chunk_type::CHUNK_MAXSIZE;
-        if (last_chunk_size == 0) {
-            last_chunk_size = chunk_type::CHUNK_MAXSIZE;
-        }
-
-        m_chunks.reserve(chunks_num);
-        for (size_type i = 0; i < chunks_num - 1; ++i, mem += obj_size * chunk_type::CHUNK_MAXSIZE) {
-            m_chunks.emplace_back(mem, obj_size, (size_type)chunk_type::CHUNK_MAXSIZE);
-        }
-        m_chunks.emplace_back(mem, obj_size, last_chunk_size);
+        m_chunks.reserve(chunks_count());
     }
 
     bool is_memory_available() const noexcept
     {
-        for (auto& chunk: m_chunks) {
-            if (chunk.is_memory_available()) {
-                return true;
-            }
-        }
-        return false;
+        return m_available > 0;
+    }
+
+    // returns true if no object of the block is allocated
+
+    bool is_empty() const noexcept
+    {
+        return m_available == m_size;
     }
 
     bool is_owned(const pointer& ptr, size_type obj_size) const noexcept
@@ -148,37 +279,163 @@ public:
         return m_size;
     }
 
-    std::pair<pointer, chunk_it> allocate(size_type obj_size)
+    size_type available() const noexcept
+    {
+        return m_available;
+    }
+
+    std::pair<pointer, chunk_it> allocate(size_type obj_size, bool prefetch = false)
+    {
+        chunk_it chk = find_available_chunk(obj_size);
+        if (chk == m_chunks.end()) {
+            return make_pair(nullptr, chk);
+        }
+        return make_pair(allocate(chk, obj_size, prefetch), chk);
+    }
+
+    // allocates object from the given chunk of this block which should have free objects
+
+    pointer allocate(const chunk_it& chk, size_type obj_size, bool prefetch = false)
     {
-        for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it) {
-            if (it->is_memory_available()) {
-                return make_pair(it->allocate(obj_size), it);
+        assert(chk->is_memory_available());
+        --m_available;
+        return chk->allocate(obj_size, prefetch);
+    }
+
+    // allocates up to n objects passing each of them to sink, returns the number of allocated objects
+
+    template <typename Sink>
+    size_type allocate_batch(size_type n, size_type obj_size, Sink& sink)
+    {
+        size_type count = 0;
+        while (count < n) {
+            chunk_it chk = find_available_chunk(obj_size);
+            if (chk == m_chunks.end()) {
+                break;
             }
+            count += chk->allocate_batch(n - count, obj_size, sink);
         }
-        return make_pair(nullptr, m_chunks.end());
+        m_available -= count;
+        return count;
     }
 
-    void deallocate(const pointer& ptr, size_type obj_size)
+    // resets chunks which are idle for decay (see chunk::check_idle)
+    // and passes memory of each run of adjacent reset chunks to purge(mem, size).
+    // Returns the sum of values returned by purge
+
+    template <typename Purge>
+    size_type purge(std::uint32_t now, std::uint32_t decay, size_type obj_size, Purge& purge)
     {
-        for (auto& chunk: m_chunks) {
-            if (chunk.is_owned(ptr, obj_size)) {
-                chunk.deallocate(ptr, obj_size);
+        size_type purged = 0;
+        chunk_it first = m_chunks.end();
+        for (chunk_it chk = m_chunks.begin(); chk != m_chunks.end(); ++chk) {
+            if (chk->check_idle(now, decay)) {
+                chk->reset();
+                if (first == m_chunks.end()) {
+                    first = chk;
+                }
+            } else if (first != m_chunks.end()) {
+                purged += purge_chunks(first, chk, obj_size, purge);
+                first = m_chunks.end();
             }
         }
+        if (first != m_chunks.end()) {
+            purged += purge_chunks(first, m_chunks.end(), obj_size, purge);
+        }
+        return purged;
+    }
+
+    chunk_it get_chunk(const pointer& ptr, size_type obj_size) noexcept
+    {
+        // all chunks except the last one have CHUNK_MAXSIZE objects,
+        // so owning chunk is found just by offset of the pointer
+        assert(is_owned(ptr, obj_size));
+        return m_chunks.begin() + (ptr - m_mem) / (obj_size * chunk_type::CHUNK_MAXSIZE);
+    }
+
+    // returns chunk which owns deallocated object
+
+    chunk_it deallocate(const pointer& ptr, size_type obj_size)
+    {
+        chunk_it chk = get_chunk(ptr, obj_size);
+        chk->deallocate(ptr, obj_size);
+        ++m_available;
+        list_chunk(chk);
+        return chk;
     }
 
 private:
+
+    template <typename Purge>
+    static size_type purge_chunks(const chunk_it& first, const chunk_it& last, size_type obj_size, Purge& purge)
+    {
+        pointer mem = first->get_memory_ptr();
+        pointer mem_end = (last - 1)->get_memory_ptr() + (last - 1)->size() * obj_size;
+        return purge(mem, mem_end - mem);
+    }
+
+    size_type chunks_count() const noexcept
+    {
+        return (m_size + chunk_type::CHUNK_MAXSIZE - 1) / chunk_type::CHUNK_MAXSIZE;
+    }
+
+    // capacity of m_chunks is reserved in constructor,
+    // so adding chunk doesn't invalidate iterators to other chunks
+
+    chunk_it add_chunk(size_type obj_size)
+    {
+        size_type offset = m_chunks.size() * chunk_type::CHUNK_MAXSIZE;
+        size_type chunk_size = std::min<size_type>(m_size - offset, chunk_type::CHUNK_MAXSIZE);
+        m_chunks.emplace_back(m_mem + offset * obj_size, obj_size, static_cast<index_type>(chunk_size));
+        return m_chunks.end() - 1;
+    }
+
+    // chunks with free objects are kept in m_available_chunks stack.
+    // Chunk is pushed there when it gets a free object and it is not in the stack yet.
+    // Chunks become full by allocation from any chunk (not only from the top one),
+    // so full chunks are removed from the stack lazily when they reach the top.
+
+    chunk_it find_available_chunk(size_type obj_size)
+    {
+        while (!m_available_chunks.empty()) {
+            size_type idx = m_available_chunks.back();
+            if (m_chunks[idx].is_memory_available()) {
+                return m_chunks.begin() + idx;
+            }
+            m_available_chunks.pop_back();
+            m_listed_chunks[idx] = false;
+        }
+        if (m_chunks.size() < chunks_count()) {
+            chunk_it chk = add_chunk(obj_size);
+            list_chunk(chk);
+            return chk;
+        }
+        return m_chunks.end();
+    }
+
+    void list_chunk(const chunk_it& chk)
+    {
+        size_type idx = chk - m_chunks.begin();
+        if (!m_listed_chunks[idx]) {
+            m_listed_chunks[idx] = true;
+            m_available_chunks.push_back(idx);
+        }
+    }
+
     pointer m_mem;
     size_type m_size;
+    size_type m_available;
     std::vector<chunk_type> m_chunks;
+    std::vector<size_type> m_available_chunks;
+    std::vector<bool> m_listed_chunks;
 };
 
-template <typename pointer, typename size_type>
+template <typename pointer, typename size_type, typename index_type = std::uint8_t>
 class memory_pool
 {
 public:
 
-    typedef memory_block<pointer, size_type> memory_block_type;
+    typedef memory_block<pointer, size_type, index_type> memory_block_type;
 
     class memory_blocks_range
     {
@@ -216,13 +473,31 @@ public:
     };
 
     explicit memory_pool(size_type obj_size) noexcept:
-        m_obj_size(obj_size)
+        m_capacity(0)
+      , m_available(0)
+      , m_empty_blocks(0)
+      , m_obj_size(obj_size)
+      , m_last_purge(0)
+      , m_next_color(0)
     {}
 
     memory_pool(memory_pool&& other) noexcept:
         m_blocks(std::move(other.m_blocks))
+      , m_blocks_index(std::move(other.m_blocks_index))
+      , m_available_blocks(std::move(other.m_available_blocks))
+      , m_listed_blocks(std::move(other.m_listed_blocks))
+      , m_last_used_chunk(other.m_last_used_chunk)
+      , m_last_dealloc_chunk(other.m_last_dealloc_chunk)
+      , m_capacity(other.m_capacity)
+      , m_available(other.m_available)
+      , m_empty_blocks(other.m_empty_blocks)
       , m_obj_size(other.m_obj_size)
-    {}
+      , m_last_purge(other.m_last_purge)
+      , m_next_color(other.m_next_color)
+    {
+        move_stack(other.m_remote_frees, m_remote_frees);
+        move_stack(other.m_unowned_frees, m_unowned_frees);
+    }
 
     size_type obj_size() const noexcept
     {
@@ -231,71 +506,340 @@ public:
 
     size_type capacity() const noexcept
     {
-        size_type cap = 0;
-        for (auto& block: m_blocks) {
-            cap += block.size();
-        }
-        return cap;
+        return m_capacity;
+    }
+
+    size_type available() const noexcept
+    {
+        return m_available;
     }
 
     bool is_memory_available() const noexcept
     {
-        if (m_last_used_chunk.is_valid() && m_last_used_chunk.get_chunk()->is_memory_available()) {
+        return m_available > 0;
+    }
+
+    // returns the number of memory blocks without allocated objects
+
+    size_type empty_blocks() const noexcept
+    {
+        return m_empty_blocks;
+    }
+
+    bool is_owned(const pointer& ptr) const noexcept
+    {
+        return find_block(ptr) != m_blocks_index.end();
+    }
+
+    // returns the color of the next memory block out of colors (slab coloring), the colors rotate
+    // over all blocks of the pool whoever adds them
+
+    size_type next_color(size_type colors) noexcept
+    {
+        size_type color = m_next_color % colors;
+        m_next_color = color + 1;
+        return color;
+    }
+
+    // returns index of the added block
+
+    size_type add_mem_block(const pointer& mem, size_type size)
+    {
+        size_type block_idx = m_blocks.size();
+        auto pos = std::upper_bound(m_blocks_index.begin(), m_blocks_index.end(), mem, address_less());
+        m_blocks_index.emplace(pos, mem, block_idx);
+        m_blocks.emplace_back(mem, m_obj_size, size);
+        m_listed_blocks.push_back(false);
+        list_block(block_idx);
+        m_capacity += size;
+        m_available += size;
+        ++m_empty_blocks;
+        return block_idx;
+    }
+
+    memory_blocks_range get_mem_blocks() const noexcept
+    {
+        return memory_blocks_range(m_blocks.begin(), m_blocks.end());
+    }
+
+    // if prefetch is true the object which is likely returned by the next allocation is prefetched
+    // (see chunk::allocate)
+
+    pointer allocate(bool prefetch = false)
+    {
+        if (!is_memory_available()) {
+            return pointer(nullptr);
+        }
+        --m_available;
+        // like in Loki's SmallObjAllocator, chunk of the last deallocation is checked first,
+        // so allocation right after deallocation reuses the same (likely cached) memory
+        if (m_last_dealloc_chunk.is_memory_available()) {
+            return allocate(m_last_dealloc_chunk.get_block(), m_last_dealloc_chunk.get_chunk(), prefetch);
+        }
+        if (m_last_used_chunk.is_memory_available()) {
+            return allocate(m_last_used_chunk.get_block(), m_last_used_chunk.get_chunk(), prefetch);
+        }
+        size_type block_idx = find_available_block();
+        use_block(block_idx);
+        auto res = m_blocks[block_idx].allocate(m_obj_size, prefetch);
+        m_last_used_chunk.set_chunk(block_idx, res.second);
+        return res.first;
+    }
+
+    // allocates n objects passing each of them to sink(const pointer&),
+    // the pool should have at least n available objects.
+    // Objects are taken from chunks by whole runs, so the cost per object is lower than of allocate()
+
+    template <typename Sink>
+    void allocate_batch(size_type n, Sink&& sink)
+    {
+        assert(n <= m_available);
+        m_available -= n;
+        while (n > 0) {
+            size_type block_idx = find_available_block();
+            use_block(block_idx);
+            n -= m_blocks[block_idx].allocate_batch(n, m_obj_size, sink);
+        }
+    }
+
+    // returns false if pointer is not owned by the pool
+
+    bool deallocate(const pointer& ptr)
+    {
+        // objects are often deallocated in the order of allocation,
+        // so the block of the last deallocation is checked before the search
+        if (m_last_dealloc_chunk.is_valid() && deallocate(ptr, m_last_dealloc_chunk.get_block())) {
             return true;
         }
-        for (auto& block: m_blocks) {
-            if (block.is_memory_available()) {
-                return true;
+        auto it = find_block(ptr);
+        if (it == m_blocks_index.end()) {
+            return false;
+        }
+        return deallocate(ptr, it->second);
+    }
+
+    // deallocates object when index of the block which may own it is already known,
+    // returns false if the block doesn't own the pointer
+
+    bool deallocate(const pointer& ptr, size_type block_idx)
+    {
+        if (!m_blocks[block_idx].is_owned(ptr, m_obj_size)) {
+            return false;
+        }
+        auto chk = m_blocks[block_idx].deallocate(ptr, m_obj_size);
+        ++m_available;
+        if (m_blocks[block_idx].is_empty()) {
+            ++m_empty_blocks;
+        }
+        list_block(block_idx);
+        m_last_dealloc_chunk.set_chunk(block_idx, chk);
+        return true;
+    }
+
+    // the following methods allow to deallocate objects from threads
+    // which don't hold the lock of the pool (remote threads).
+    // Objects should be at least sizeof(void*) bytes and aligned to alignof(void*)
+
+    // deallocates object owned by the pool, may be called concurrently with any other method.
+    // Object stays unavailable until the next collect_remote()
+
+    void remote_deallocate(const pointer& ptr) noexcept
+    {
+        assert(m_obj_size >= sizeof(void*));
+        m_remote_frees.push(static_cast<void*>(ptr));
+    }
+
+    bool has_remote_frees() const noexcept
+    {
+        return !m_remote_frees.empty();
+    }
+
+    // deallocates all objects which were deallocated by remote threads since the last call,
+    // returns the number of collected objects. Objects not owned by the pool are kept aside
+    // until they are taken by take_unowned()
+
+    size_type collect_remote()
+    {
+        size_type count = 0;
+        void* mem = m_remote_frees.pop_all();
+        while (mem) {
+            void* next = lockfree_stack::next(mem);
+            if (deallocate(static_cast<pointer>(mem))) {
+                ++count;
+            } else {
+                m_unowned_frees.push(mem);
             }
+            mem = next;
         }
-        return false;
+        return count;
     }
 
-    bool is_owned(const pointer& ptr) const noexcept
+    bool has_unowned() const noexcept
+    {
+        return !m_unowned_frees.empty();
+    }
+
+    // returns the list of remotely deallocated objects not owned by the pool (see lockfree_stack::next),
+    // may be called concurrently with any other method
+
+    void* take_unowned() noexcept
+    {
+        return m_unowned_frees.pop_all();
+    }
+
+    // discards memory of chunks which have no allocated objects for decay time units,
+    // the memory stays in the pool. now is the current time (i.e. details::purge_clock()).
+    // Chunk becomes idle at the first call which finds it empty, so the method should be called periodically.
+    // purge(mem, size) is called for each run of adjacent idle chunks, it should release physical memory
+    // of the range (i.e. by details::purge_pages) and return the number of released bytes.
+    // Idle chunks forget their lists of free objects, so the discarded memory is never read by the pool.
+    // Returns the total number of released bytes
+
+    template <typename Purge>
+    size_type purge(std::uint32_t now, std::uint32_t decay, Purge&& purge)
     {
+        size_type purged = 0;
         for (auto& block: m_blocks) {
-            if (block.is_owned(ptr, m_obj_size)) {
-                return true;
+            purged += block.purge(now, decay, m_obj_size, purge);
+        }
+        m_last_purge = now;
+        return purged;
+    }
+
+    // returns the time passed to the last call of purge()
+
+    std::uint32_t last_purge() const noexcept
+    {
+        return m_last_purge;
+    }
+
+    // removes empty memory blocks from the pool keeping at most spare_blocks of them,
+    // release(mem, size) is called for each removed block to free its memory.
+    // Returns the number of objects by which the capacity of the pool is reduced.
+    // Indices of remaining blocks may change.
+    // Objects deallocated by remote threads keep their blocks in use until they are collected
+
+    template <typename Release>
+    size_type trim(size_type spare_blocks, Release&& release)
+    {
+        if (m_empty_blocks <= spare_blocks) {
+            return 0;
+        }
+        size_type released = 0;
+        size_type kept = 0;
+        for (size_type i = 0; i < m_blocks.size(); ++i) {
+            if (m_blocks[i].is_empty()) {
+                if (spare_blocks == 0) {
+                    release(m_blocks[i].get_memory_ptr(), m_blocks[i].size());
+                    released += m_blocks[i].size();
+                    continue;
+                }
+                --spare_blocks;
             }
+            if (kept != i) {
+                m_blocks[kept] = std::move(m_blocks[i]);
+            }
+            ++kept;
         }
-        return false;
+        m_blocks.erase(m_blocks.begin() + kept, m_blocks.end());
+        m_capacity -= released;
+        m_available -= released;
+        rebuild_index();
+        return released;
     }
 
-    void add_mem_block(const pointer& mem, size_type size)
+private:
+
+    // memory blocks sorted by their start address,
+    // each entry keeps an index of block in m_blocks
+    typedef std::pair<pointer, size_type> block_index_entry;
+    typedef typename std::vector<block_index_entry>::const_iterator block_index_it;
+
+    struct address_less
     {
-        m_blocks.emplace_back(mem, m_obj_size, size);
+        bool operator()(const pointer& ptr, const block_index_entry& entry) const noexcept
+        {
+            return ptr < entry.first;
+        }
+    };
+
+    block_index_it find_block(const pointer& ptr) const noexcept
+    {
+        auto it = std::upper_bound(m_blocks_index.begin(), m_blocks_index.end(), ptr, address_less());
+        if (it == m_blocks_index.begin()) {
+            return m_blocks_index.end();
+        }
+        --it;
+        if (!m_blocks[it->second].is_owned(ptr, m_obj_size)) {
+            return m_blocks_index.end();
+        }
+        return it;
     }
 
-    memory_blocks_range get_mem_blocks() const noexcept
+    typedef typename memory_block_type::chunk_it chunk_it;
+
+    pointer allocate(size_type block_idx, const chunk_it& chk, bool prefetch)
     {
-        return memory_blocks_range(m_blocks.begin(), m_blocks.end());
+        use_block(block_idx);
+        return m_blocks[block_idx].allocate(chk, m_obj_size, prefetch);
     }
 
-    pointer allocate()
+    // should be called before allocation from the block
+
+    void use_block(size_type block_idx) noexcept
     {
-        if (m_last_used_chunk.is_valid() && m_last_used_chunk.get_chunk()->is_memory_available()) {
-            return m_last_used_chunk.get_chunk()->allocate(m_obj_size);
+        if (m_blocks[block_idx].is_empty()) {
+            --m_empty_blocks;
         }
-        for (auto& block: m_blocks) {
-            if (block.is_memory_available()) {
-                auto res = block.allocate(m_obj_size);
-                m_last_used_chunk.set_chunk(res.second);
-                return res.first;
+    }
+
+    // restores the index of blocks, the stack of available blocks and the counter of empty blocks
+    // after removal of blocks
+
+    void rebuild_index()
+    {
+        m_blocks_index.clear();
+        m_available_blocks.clear();
+        m_listed_blocks.assign(m_blocks.size(), false);
+        m_empty_blocks = 0;
+        for (size_type i = 0; i < m_blocks.size(); ++i) {
+            m_blocks_index.emplace_back(m_blocks[i].get_memory_ptr(), i);
+            if (m_blocks[i].is_memory_available()) {
+                list_block(i);
+            }
+            if (m_blocks[i].is_empty()) {
+                ++m_empty_blocks;
             }
         }
-        return pointer(nullptr);
+        std::sort(m_blocks_index.begin(), m_blocks_index.end(),
+                  [](const block_index_entry& a, const block_index_entry& b) { return a.first < b.first; });
+        m_last_used_chunk.invalidate();
+        m_last_dealloc_chunk.invalidate();
     }
 
-    void deallocate(const pointer& ptr)
+    // blocks with free objects are tracked in the same way as chunks inside memory_block:
+    // they are kept in m_available_blocks stack and full blocks are removed from it lazily
+
+    size_type find_available_block() noexcept
     {
-        for (auto& block: m_blocks) {
-            if (block.is_owned(ptr, m_obj_size)) {
-                block.deallocate(ptr, m_obj_size);
+        while (true) {
+            assert(!m_available_blocks.empty());
+            size_type idx = m_available_blocks.back();
+            if (m_blocks[idx].is_memory_available()) {
+                return idx;
             }
+            m_available_blocks.pop_back();
+            m_listed_blocks[idx] = false;
         }
     }
 
-private:
+    void list_block(size_type idx)
+    {
+        if (!m_listed_blocks[idx]) {
+            m_listed_blocks[idx] = true;
+            m_available_blocks.push_back(idx);
+        }
+    }
 
     class cached_chunk
     {
@@ -304,14 +848,21 @@ private:
 
         cached_chunk() noexcept:
             m_valid(false)
+          , m_block(0)
         {}
 
-        void set_chunk(const chunk_it& chk) noexcept
+        void set_chunk(size_type block, const chunk_it& chk) noexcept
         {
             m_valid = true;
+            m_block = block;
             m_chunk = chk;
         }
 
+        size_type get_block() const noexcept
+        {
+            return m_block;
+        }
+
         chunk_it get_chunk() const noexcept
         {
             return m_chunk;
@@ -322,6 +873,11 @@ private:
             return m_valid;
         }
 
+        bool is_memory_available() const noexcept
+        {
+            return m_valid && m_chunk->is_memory_available();
+        }
+
         void invalidate() noexcept
         {
             m_valid = false;
@@ -329,25 +885,105 @@ private:
 
     private:
         bool m_valid;
+        size_type m_block;
         chunk_it m_chunk;
     };
 
+    static void move_stack(lockfree_stack& from, lockfree_stack& to) noexcept
+    {
+        void* mem = from.pop_all();
+        while (mem) {
+            void* next = lockfree_stack::next(mem);
+            to.push(mem);
+            mem = next;
+        }
+    }
+
     std::vector<memory_block_type> m_blocks;
+    std::vector<block_index_entry> m_blocks_index;
+    std::vector<size_type> m_available_blocks;
+    std::vector<bool> m_listed_blocks;
     cached_chunk m_last_used_chunk;
+    cached_chunk m_last_dealloc_chunk;
+    lockfree_stack m_remote_frees;
+    lockfree_stack m_unowned_frees;
+    size_type m_capacity;
+    size_type m_available;
+    size_type m_empty_blocks;
     size_type m_obj_size;
+    std::uint32_t m_last_purge;
+    size_type m_next_color;
 };
 
-template <typename pointer, typename size_type>
+// mutex which does nothing, used by pools_manager when it is not shared between threads
+
+struct null_mutex
+{
+    void lock() noexcept
+    {}
+
+    bool try_lock() noexcept
+    {
+        return true;
+    }
+
+    void unlock() noexcept
+    {}
+};
+
+// pools_manager keeps pools of objects of different sizes sharing the same upstream allocator.
+//
+// If lockable is not null_mutex the manager may be shared between threads:
+//  - mutex() guards the set of pools and the registry of memory blocks,
+//    it should be locked by the user around get_pool(obj_size), release_pool, erase_pool,
+//    add_mem_block, find_pool, is_owned, deallocate and iteration over pools;
+//  - each pool has its own mutex (get_pool_mutex) guarding the state of the pool,
+//    it should be locked by the user around calls to the pool itself;
+//  - mutex() should always be locked before the mutex of any pool;
+//  - get_pool(obj_size, std::nothrow), get_pool_id and get_pool_mutex are lock free
+//    for sizes not greater than MAX_INDEXED_OBJ_SIZE, for greater sizes they also require mutex().
+//    get_pool(obj_size, std::nothrow) may be used without the lock only by a user
+//    which already holds a reference to the pool (i.e. to copy it).
+
+template <typename pointer, typename size_type, typename index_type = std::uint8_t,
+          typename lockable = null_mutex>
 class pools_manager
 {
 public:
 
-    typedef memory_pool<pointer, size_type> pool_type;
-    typedef std::pair<pool_type, int> pool_with_ref_count;
+    typedef memory_pool<pointer, size_type, index_type> pool_type;
+    typedef lockable mutex_type;
+
+    static const bool THREAD_SAFE = !std::is_same<mutex_type, null_mutex>::value;
+
+private:
+
+    // values which are read without locks in thread safe mode
+
+    template <typename T>
+    using shared_value = typename std::conditional<THREAD_SAFE, std::atomic<T>, T>::type;
+
+    struct pool_entry
+    {
+        pool_entry() noexcept:
+            pool(nullptr)
+          , ref_count(0)
+          , id(0)
+        {}
+
+        shared_value<pool_type*> pool;
+        shared_value<int> ref_count;
+        shared_value<std::uint64_t> id;
+        mutable mutex_type mutex;
+    };
+
+public:
+
+    static const size_type MAX_INDEXED_OBJ_SIZE = 256;
 
     class iterator
     {
-        typedef typename std::list<pool_with_ref_count>::iterator inner_iterator_type;
+        typedef typename std::vector<pool_type*>::iterator inner_iterator_type;
 
     public:
 
@@ -357,12 +993,12 @@ public:
 
         pool_type& operator*() const noexcept
         {
-            return m_inner_it->first;
+            return **m_inner_it;
         }
 
         pool_type* operator->() const noexcept
         {
-            return &m_inner_it->first;
+            return *m_inner_it;
         }
 
         const iterator& operator++() noexcept
@@ -392,14 +1028,84 @@ public:
         inner_iterator_type m_inner_it;
     };
 
-    friend bool operator==(const iterator& it1, const iterator& it2) noexcept
+    pools_manager():
+        m_table(MAX_INDEXED_OBJ_SIZE + 1)
+    {}
+
+    pools_manager(const pools_manager&) = delete;
+    pools_manager& operator=(const pools_manager&) = delete;
+
+    ~pools_manager()
+    {
+        for (pool_type* pool: m_pools) {
+            delete pool;
+        }
+    }
+
+    // memory blocks should be added to pools through the manager,
+    // so it is able to find the owning pool of any pointer.
+    // Mutex of the pool should be locked as well
+
+    void add_mem_block(pool_type* pool, const pointer& mem, size_type size)
     {
-        return it1.operator==(it2);
+        size_type block_idx = pool->add_mem_block(mem, size);
+        auto pos = std::upper_bound(m_blocks.begin(), m_blocks.end(), mem, address_less());
+        m_blocks.insert(pos, block_entry{mem, pool, &find_entry(pool->obj_size())->mutex, block_idx});
     }
 
-    friend bool operator!=(const iterator& it1, const iterator& it2) noexcept
+    // removes empty memory blocks of the pool keeping at most spare_blocks of them (see memory_pool::trim).
+    // Mutex of the pool should be locked as well
+
+    template <typename Release>
+    size_type trim(pool_type* pool, size_type spare_blocks, Release&& release)
     {
-        return it1.operator!=(it2);
+        size_type released = pool->trim(spare_blocks, release);
+        if (released == 0) {
+            return 0;
+        }
+        // indices of blocks are changed by trim, so entries of the pool are recreated.
+        // Their number decreases, thus the registry doesn't reallocate
+        mutex_type* mutex = &find_entry(pool->obj_size())->mutex;
+        m_blocks.erase(std::remove_if(m_blocks.begin(), m_blocks.end(),
+                                      [pool](const block_entry& block) { return block.pool == pool; }),
+                       m_blocks.end());
+        typename pool_type::memory_blocks_range range = pool->get_mem_blocks();
+        size_type block_idx = 0;
+        for (auto it = range.begin(); it != range.end(); ++it, ++block_idx) {
+            m_blocks.push_back(block_entry{it->get_memory_ptr(), pool, mutex, block_idx});
+        }
+        std::sort(m_blocks.begin(), m_blocks.end(),
+                  [](const block_entry& a, const block_entry& b) { return a.mem < b.mem; });
+        return released;
+    }
+
+    pool_type* find_pool(const pointer& ptr) const
+    {
+        auto it = find_block(ptr);
+        if (it == m_blocks.end()) {
+            return nullptr;
+        }
+        std::lock_guard<mutex_type> lock(*it->mutex);
+        return it->pool->is_owned(ptr) ? it->pool : nullptr;
+    }
+
+    bool is_owned(const pointer& ptr) const
+    {
+        return find_pool(ptr) != nullptr;
+    }
+
+    // deallocates object in any pool of the manager with single lookup,
+    // returns false if pointer is not owned by any pool.
+    // Locks the mutex of the owning pool by itself
+
+    bool deallocate(const pointer& ptr)
+    {
+        auto it = find_block(ptr);
+        if (it == m_blocks.end()) {
+            return false;
+        }
+        std::lock_guard<mutex_type> lock(*it->mutex);
+        return it->pool->deallocate(ptr, it->block);
     }
 
     pool_type* get_pool(size_type obj_size)
@@ -408,49 +1114,86 @@ public:
         if (pool != nullptr) {
             return pool;
         }
-        pool_type new_pool(obj_size);
-        m_pools.emplace_back(std::move(new_pool), 1);
-        return &m_pools.back().first;
+        pool_entry& entry = obj_size <= MAX_INDEXED_OBJ_SIZE ? m_table[obj_size] : m_large_pools[obj_size];
+        pool = new pool_type(obj_size);
+        entry.ref_count = 1;
+        entry.id = next_pool_id();
+        // publish the pool after it is fully initialized
+        entry.pool = pool;
+        m_pools.push_back(pool);
+        return pool;
     }
 
     pool_type* get_pool(size_type obj_size, std::nothrow_t) noexcept
     {
-        for (auto& pool_with_rc: m_pools) {
-            if (pool_with_rc.first.obj_size() == obj_size) {
-                ++pool_with_rc.second;
-                return &pool_with_rc.first;
-            }
+        pool_entry* entry = find_entry(obj_size);
+        if (!entry) {
+            return nullptr;
         }
-        return nullptr;
+        ++entry->ref_count;
+        return entry->pool;
     }
 
-    void release_pool(size_type obj_size) noexcept
+    // returns the number of references to the pool left
+
+    int release_pool(size_type obj_size) noexcept
     {
-        for (auto& pool_with_rc: m_pools) {
-            if (pool_with_rc.first.obj_size() == obj_size) {
-                --pool_with_rc.second;
-            }
+        pool_entry* entry = find_entry(obj_size);
+        if (!entry) {
+            return 0;
         }
+        return --entry->ref_count;
     }
 
     void erase_pool(size_type obj_size) noexcept
     {
-        for (auto it = m_pools.begin(); it != m_pools.end(); ++it) {
-            if (it->first.obj_size() == obj_size) {
-                m_pools.erase(it);
-                return;
-            }
+        pool_entry* entry = find_entry(obj_size);
+        if (!entry) {
+            return;
+        }
+        pool_type* pool = entry->pool;
+        m_pools.erase(std::find(m_pools.begin(), m_pools.end(), pool));
+        m_blocks.erase(std::remove_if(m_blocks.begin(), m_blocks.end(),
+                                      [pool](const block_entry& block) { return block.pool == pool; }),
+                       m_blocks.end());
+        if (obj_size <= MAX_INDEXED_OBJ_SIZE) {
+            entry->pool = nullptr;
+            entry->ref_count = 0;
+            entry->id = 0;
+        } else {
+            m_large_pools.erase(obj_size);
         }
+        delete pool;
     }
 
     int get_pool_ref_count(size_type obj_size) const noexcept
     {
-        for (auto& pool_with_rc: m_pools) {
-            if (pool_with_rc.first.obj_size() == obj_size) {
-                return pool_with_rc.second;
-            }
-        }
-        return 0;
+        const pool_entry* entry = find_entry(obj_size);
+        return entry ? static_cast<int>(entry->ref_count) : 0;
+    }
+
+    // returns identifier of the pool which is unique among all pools of all managers of this type,
+    // so a pool can be told apart from one created later for the same size (or at the same address).
+    // Returns 0 if there is no pool for objects of given size
+
+    std::uint64_t get_pool_id(size_type obj_size) const noexcept
+    {
+        const pool_entry* entry = find_entry(obj_size);
+        return entry ? static_cast<std::uint64_t>(entry->id) : 0;
+    }
+
+    // pool for objects of given size should exist
+
+    mutex_type& get_pool_mutex(size_type obj_size) const noexcept
+    {
+        const pool_entry* entry = find_entry(obj_size);
+        assert(entry);
+        return entry->mutex;
+    }
+
+    mutex_type& mutex() const noexcept
+    {
+        return m_mutex;
     }
 
     iterator begin() noexcept
@@ -464,9 +1207,74 @@ public:
     }
 
 private:
-    std::list<pool_with_ref_count> m_pools;
+
+    // memory blocks of all pools sorted by their start address
+
+    struct block_entry
+    {
+        pointer mem;
+        pool_type* pool;
+        mutex_type* mutex;
+        size_type block;
+    };
+
+    typedef typename std::vector<block_entry>::const_iterator block_entry_it;
+
+    struct address_less
+    {
+        bool operator()(const pointer& ptr, const block_entry& entry) const noexcept
+        {
+            return ptr < entry.mem;
+        }
+    };
+
+    // returns the last block which starts not after ptr,
+    // the block still may not own the pointer
+
+    block_entry_it find_block(const pointer& ptr) const noexcept
+    {
+        auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), ptr, address_less());
+        return it == m_blocks.begin() ? m_blocks.end() : --it;
+    }
+
+    // returns nullptr if there is no pool for objects of given size
+
+    const pool_entry* find_entry(size_type obj_size) const noexcept
+    {
+        const pool_entry* entry = nullptr;
+        if (obj_size <= MAX_INDEXED_OBJ_SIZE) {
+            entry = &m_table[obj_size];
+        } else {
+            auto it = m_large_pools.find(obj_size);
+            entry = it != m_large_pools.end() ? &it->second : nullptr;
+        }
+        return entry && entry->pool ? entry : nullptr;
+    }
+
+    pool_entry* find_entry(size_type obj_size) noexcept
+    {
+        return const_cast<pool_entry*>(static_cast<const pools_manager*>(this)->find_entry(obj_size));
+    }
+
+    static std::uint64_t next_pool_id() noexcept
+    {
+        static std::atomic<std::uint64_t> last_id(0);
+        return ++last_id;
+    }
+
+    mutable mutex_type m_mutex;
+    std::vector<pool_entry> m_table;
+    std::map<size_type, pool_entry> m_large_pools;
+    std::vector<pool_type*> m_pools;
+    std::vector<block_entry> m_blocks;
 };
 
+template <typename pointer, typename size_type, typename index_type, typename lockable>
+const bool pools_manager<pointer, size_type, index_type, lockable>::THREAD_SAFE;
+
+template <typename pointer, typename size_type, typename index_type, typename lockable>
+const size_type pools_manager<pointer, size_type, index_type, lockable>::MAX_INDEXED_OBJ_SIZE;
+
 }   // namespace details
 
 } // namespace alloc_utility
@@ -79,6 +79,21 @@ namespace details
             base::swap(other);
         }
 
+        // batch operations are forwarded to the first policy if it supports them,
+        // otherwise they are performed object by object through the whole list
+
+        template <typename OutputIt>
+        OutputIt allocate_batch(size_type n, OutputIt out)
+        {
+            return allocate_batch_helper<alloc_policy>(n, out);
+        }
+
+        template <typename InputIt>
+        void deallocate_batch(InputIt first, InputIt last)
+        {
+            deallocate_batch_helper<alloc_policy>(first, last);
+        }
+
         bool operator==(const policies_list& other) const
         {
             return equal_to_helper<alloc_policy>(other);
@@ -91,6 +106,40 @@ namespace details
 
     private:
 
+        template <typename policy, typename OutputIt>
+        auto allocate_batch_helper(size_type n, OutputIt out)
+            -> typename std::enable_if<details::supports_batch_allocation<policy>::value, OutputIt>::type
+        {
+            return base::allocate_batch(n, out);
+        }
+
+        template <typename policy, typename OutputIt>
+        auto allocate_batch_helper(size_type n, OutputIt out)
+            -> typename std::enable_if<!details::supports_batch_allocation<policy>::value, OutputIt>::type
+        {
+            for (; n > 0; --n) {
+                *out = base::allocate(1, nullptr);
+                ++out;
+            }
+            return out;
+        }
+
+        template <typename policy, typename InputIt>
+        auto deallocate_batch_helper(InputIt first, InputIt last)
+            -> typename std::enable_if<details::supports_batch_allocation<policy>::value>::type
+        {
+            base::deallocate_batch(first, last);
+        }
+
+        template <typename policy, typename InputIt>
+        auto deallocate_batch_helper(InputIt first, InputIt last)
+            -> typename std::enable_if<!details::supports_batch_allocation<policy>::value>::type
+        {
+            for (; first != last; ++first) {
+                base::deallocate(*first, 1);
+            }
+        }
+
         template <typename policy>
         auto equal_to_helper(const policies_list& other) const
             -> typename std::enable_if<details::supports_equality<policy, policy>::value, bool>::type
@@ -0,0 +1,81 @@
+#ifndef PURGE_HPP
+#define PURGE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "macro.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define ALLOC_HAS_PURGE_PAGES 1
+#endif
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+inline std::size_t page_size() noexcept
+{
+#ifdef ALLOC_HAS_PURGE_PAGES
+    static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+// gives physical memory of whole pages inside [mem, mem + size) back to the system keeping them mapped:
+// the contents of the pages is lost and they are zero filled (or keep old data if lazy) on the next access.
+// If lazy is true and the system supports it (MADV_FREE) pages are reclaimed only under memory pressure,
+// which is cheaper but doesn't reduce RSS immediately.
+// Memory should be private anonymous memory (i.e. obtained from malloc or operator new).
+// Returns the number of purged bytes, it is 0 on platforms without madvise
+
+inline std::size_t purge_pages(void* mem, std::size_t size, bool lazy = false) noexcept
+{
+#ifdef ALLOC_HAS_PURGE_PAGES
+    const std::uintptr_t page_mask = page_size() - 1;
+    std::uintptr_t first = (reinterpret_cast<std::uintptr_t>(mem) + page_mask) & ~page_mask;
+    std::uintptr_t last = (reinterpret_cast<std::uintptr_t>(mem) + size) & ~page_mask;
+    if (first >= last) {
+        return 0;
+    }
+    int advice = MADV_DONTNEED;
+#ifdef MADV_FREE
+    if (lazy) {
+        advice = MADV_FREE;
+    }
+#else
+    ALLOC_UNUSED(lazy);
+#endif
+    if (madvise(reinterpret_cast<void*>(first), last - first, advice) != 0) {
+        return 0;
+    }
+    return last - first;
+#else
+    ALLOC_UNUSED(mem);
+    ALLOC_UNUSED(size);
+    ALLOC_UNUSED(lazy);
+    return 0;
+#endif
+}
+
+// time in milliseconds used to measure how long memory stays idle before it is purged.
+// It wraps around in about 49 days, so decay times should be shorter than that
+
+inline std::uint32_t purge_clock() noexcept
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+}
+
+}   // namespace details
+
+} // namespace alloc_utility
+
+#endif // PURGE_HPP
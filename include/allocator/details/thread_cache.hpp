@@ -0,0 +1,179 @@
+#ifndef THREAD_CACHE_HPP
+#define THREAD_CACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// thread_cache keeps per thread magazines of free objects of pools of pools_manager_type.
+// Each magazine belongs to one pool (identified by pools_manager::get_pool_id)
+// and is refilled from/flushed to it by the user in batches.
+// Magazines of the thread are returned to their pools on thread exit,
+// magazines of destroyed pools are silently dropped.
+
+template <typename pointer, typename size_type, typename pools_manager_type>
+class thread_cache
+{
+public:
+
+    class magazine
+    {
+    public:
+
+        magazine(const std::shared_ptr<pools_manager_type>& manager,
+                 size_type obj_size, std::uint64_t pool_id, size_type capacity):
+            m_manager(manager)
+          , m_obj_size(obj_size)
+          , m_pool_id(pool_id)
+        {
+            m_slots.reserve(capacity);
+        }
+
+        bool empty() const noexcept
+        {
+            return m_slots.empty();
+        }
+
+        size_type size() const noexcept
+        {
+            return m_slots.size();
+        }
+
+        void push(const pointer& ptr) noexcept
+        {
+            // doesn't reallocate since magazine is never filled over its capacity
+            m_slots.push_back(ptr);
+        }
+
+        pointer pop() noexcept
+        {
+            pointer ptr = m_slots.back();
+            m_slots.pop_back();
+            return ptr;
+        }
+
+        std::uint64_t pool_id() const noexcept
+        {
+            return m_pool_id;
+        }
+
+        bool is_expired() const noexcept
+        {
+            return m_manager.expired();
+        }
+
+        // returns all objects of the magazine to their pool
+
+        void drain() noexcept
+        {
+            std::shared_ptr<pools_manager_type> manager = m_manager.lock();
+            if (manager) {
+                std::lock_guard<typename pools_manager_type::mutex_type> lock(manager->mutex());
+                if (manager->get_pool_id(m_obj_size) == m_pool_id) {
+                    for (auto& ptr: m_slots) {
+                        manager->deallocate(ptr);
+                    }
+                }
+            }
+            m_slots.clear();
+        }
+
+    private:
+        std::weak_ptr<pools_manager_type> m_manager;
+        size_type m_obj_size;
+        std::uint64_t m_pool_id;
+        std::vector<pointer> m_slots;
+    };
+
+    thread_cache() noexcept:
+        m_last(0)
+    {}
+
+    thread_cache(const thread_cache&) = delete;
+    thread_cache& operator=(const thread_cache&) = delete;
+
+    ~thread_cache()
+    {
+        for (auto& mag: m_magazines) {
+            mag.drain();
+        }
+        is_destroyed() = true;
+    }
+
+    // returns cache of calling thread or nullptr if it is already destroyed
+    // (allocations made by destructors of other thread local or static objects)
+
+    static thread_cache* instance()
+    {
+        if (is_destroyed()) {
+            return nullptr;
+        }
+        static thread_local thread_cache cache;
+        return &cache;
+    }
+
+    // returns magazine of calling thread for the pool, creates it if necessary
+
+    magazine& get_magazine(const std::shared_ptr<pools_manager_type>& manager,
+                           size_type obj_size, std::uint64_t pool_id, size_type capacity)
+    {
+        if (m_last < m_magazines.size() && m_magazines[m_last].pool_id() == pool_id) {
+            return m_magazines[m_last];
+        }
+        for (m_last = 0; m_last < m_magazines.size(); ++m_last) {
+            if (m_magazines[m_last].pool_id() == pool_id) {
+                return m_magazines[m_last];
+            }
+        }
+        erase_expired();
+        m_magazines.emplace_back(manager, obj_size, pool_id, capacity);
+        m_last = m_magazines.size() - 1;
+        return m_magazines.back();
+    }
+
+    // drops magazine of the pool without returning objects to it,
+    // should be called when the pool is destroyed
+
+    void erase_magazine(std::uint64_t pool_id) noexcept
+    {
+        for (auto it = m_magazines.begin(); it != m_magazines.end(); ++it) {
+            if (it->pool_id() == pool_id) {
+                m_magazines.erase(it);
+                return;
+            }
+        }
+    }
+
+private:
+
+    static bool& is_destroyed() noexcept
+    {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    void erase_expired() noexcept
+    {
+        auto it = m_magazines.begin();
+        while (it != m_magazines.end()) {
+            it = it->is_expired() ? m_magazines.erase(it) : it + 1;
+        }
+    }
+
+    std::vector<magazine> m_magazines;
+    size_type m_last;
+};
+
+}   // namespace details
+
+} // namespace alloc_utility
+
+#endif // THREAD_CACHE_HPP
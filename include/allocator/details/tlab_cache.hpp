@@ -0,0 +1,239 @@
+#ifndef TLAB_CACHE_HPP
+#define TLAB_CACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "linear_storage.hpp"
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// usage of thread local allocation buffers of one thread carved from one shared storage
+
+template <typename size_type>
+class tlab_statistic
+{
+public:
+
+    tlab_statistic() noexcept:
+        m_buffers_count(0)
+      , m_buffers_size(0)
+      , m_used(0)
+      , m_wasted(0)
+    {}
+
+    // number of buffers taken from the shared storage (refills)
+
+    size_type buffers_count() const noexcept
+    {
+        return m_buffers_count;
+    }
+
+    // total size of buffers taken from the shared storage in bytes
+
+    size_type buffers_size() const noexcept
+    {
+        return m_buffers_size;
+    }
+
+    // bytes allocated from the buffers including alignment padding and not freed (see free_last)
+
+    size_type used() const noexcept
+    {
+        return m_used;
+    }
+
+    // bytes left unused at the end of the buffers abandoned by refills
+
+    size_type wasted() const noexcept
+    {
+        return m_wasted;
+    }
+
+    void register_buffer(size_type size) noexcept
+    {
+        ++m_buffers_count;
+        m_buffers_size += size;
+    }
+
+    void register_use(size_type size) noexcept
+    {
+        m_used += size;
+    }
+
+    void register_release(size_type size) noexcept
+    {
+        m_used -= size;
+    }
+
+    void register_waste(size_type size) noexcept
+    {
+        m_wasted += size;
+    }
+
+private:
+    size_type m_buffers_count;
+    size_type m_buffers_size;
+    size_type m_used;
+    size_type m_wasted;
+};
+
+// tlab_cache keeps the buffers of the calling thread carved from shared storages of storage_type
+// (i.e. concurrent_linear_storage). Buffers are bump allocated without synchronization,
+// the shared storage is touched only to take a new buffer. Memory of buffers belongs to the storage,
+// so nothing is returned on thread exit. Buffers of destroyed storages are dropped on lookup,
+// buffers of reset storages (see concurrent_linear_storage::generation) are dropped by the user
+
+template <typename pointer, typename size_type, typename storage_type>
+class tlab_cache
+{
+public:
+
+    class tlab
+    {
+    public:
+
+        tlab(const std::shared_ptr<storage_type>& storage) noexcept:
+            m_storage(storage)
+          , m_key(storage.get())
+          , m_generation(storage->generation())
+        {}
+
+        const storage_type* key() const noexcept
+        {
+            return m_key;
+        }
+
+        bool is_expired() const noexcept
+        {
+            return m_storage.expired();
+        }
+
+        // memory of the buffer may be allocated again by the storage
+
+        bool is_outdated(const storage_type& storage) const noexcept
+        {
+            return m_generation != storage.generation();
+        }
+
+        linear_storage<pointer, size_type>& buffer() noexcept
+        {
+            return m_buffer;
+        }
+
+        tlab_statistic<size_type>& statistic() noexcept
+        {
+            return m_stat;
+        }
+
+        // replaces the buffer, the rest of the previous one is wasted unless it is outdated
+
+        void set_buffer(const storage_type& storage, const pointer& mem, size_type size) noexcept
+        {
+            if (!is_outdated(storage) && m_buffer.get_storage()) {
+                m_stat.register_waste(m_buffer.storage_size() - m_buffer.get_marker());
+            }
+            m_generation = storage.generation();
+            m_buffer.set_storage(mem, size);
+            m_stat.register_buffer(size);
+        }
+
+        void drop_buffer(const storage_type& storage) noexcept
+        {
+            m_generation = storage.generation();
+            m_buffer = linear_storage<pointer, size_type>();
+        }
+
+    private:
+        std::weak_ptr<storage_type> m_storage;
+        const storage_type* m_key;
+        std::uint64_t m_generation;
+        linear_storage<pointer, size_type> m_buffer;
+        tlab_statistic<size_type> m_stat;
+    };
+
+    tlab_cache() noexcept:
+        m_last(0)
+    {}
+
+    tlab_cache(const tlab_cache&) = delete;
+    tlab_cache& operator=(const tlab_cache&) = delete;
+
+    ~tlab_cache()
+    {
+        is_destroyed() = true;
+    }
+
+    // returns cache of calling thread or nullptr if it is already destroyed
+
+    static tlab_cache* instance()
+    {
+        if (is_destroyed()) {
+            return nullptr;
+        }
+        static thread_local tlab_cache cache;
+        return &cache;
+    }
+
+    // returns buffer of calling thread for the storage, creates an empty one if necessary
+
+    tlab& get_tlab(const std::shared_ptr<storage_type>& storage)
+    {
+        if (m_last < m_tlabs.size() && m_tlabs[m_last].key() == storage.get() && !m_tlabs[m_last].is_expired()) {
+            return m_tlabs[m_last];
+        }
+        erase_expired();
+        for (m_last = 0; m_last < m_tlabs.size(); ++m_last) {
+            if (m_tlabs[m_last].key() == storage.get()) {
+                return m_tlabs[m_last];
+            }
+        }
+        m_tlabs.emplace_back(storage);
+        m_last = m_tlabs.size() - 1;
+        return m_tlabs.back();
+    }
+
+    // returns buffer of calling thread for the storage or nullptr if the thread has no buffer
+
+    tlab* find_tlab(const storage_type* storage) noexcept
+    {
+        for (auto& t: m_tlabs) {
+            if (t.key() == storage && !t.is_expired()) {
+                return &t;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+
+    static bool& is_destroyed() noexcept
+    {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    // a new storage may have the address of a destroyed one, so expired buffers are erased before the search
+
+    void erase_expired() noexcept
+    {
+        auto it = m_tlabs.begin();
+        while (it != m_tlabs.end()) {
+            it = it->is_expired() ? m_tlabs.erase(it) : it + 1;
+        }
+    }
+
+    std::vector<tlab> m_tlabs;
+    size_type m_last;
+};
+
+}   // namespace details
+
+} // namespace alloc_utility
+
+#endif // TLAB_CACHE_HPP
@@ -0,0 +1,51 @@
+#ifndef UPSTREAM_HPP
+#define UPSTREAM_HPP
+
+#include <cstddef>
+
+#include "pointer_cast.hpp"
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// unit of memory of N bytes aligned by N, N should be a power of 2
+
+template <std::size_t N>
+struct alignas(N) upstream_unit
+{
+    unsigned char bytes[N];
+};
+
+// memory shared by rebinded copies of a policy (pool blocks, arena regions) is allocated from base_policy
+// rebinded to unit_type, so it doesn't depend on the type of the copy which allocates or releases it
+// and is given back with the same size. Sizes are in bytes, they should be multiples of sizeof(unit_type)
+
+template <typename unit_type, typename byte_pointer, typename base_policy, typename size_type, typename hint_type>
+byte_pointer upstream_allocate(const base_policy& policy, size_type size, const hint_type& hint)
+{
+    typedef typename base_policy::template rebind<unit_type> upstream_policy;
+    typedef typename upstream_policy::pointer upstream_pointer;
+
+    upstream_policy upstream(policy);
+    upstream_pointer mem = upstream.allocate(size / sizeof(unit_type), upstream_pointer(nullptr), hint);
+    return pointer_cast_traits<byte_pointer>::reinterpret_pcast(mem);
+}
+
+template <typename unit_type, typename byte_pointer, typename base_policy, typename size_type>
+void upstream_deallocate(const base_policy& policy, const byte_pointer& mem, size_type size)
+{
+    typedef typename base_policy::template rebind<unit_type> upstream_policy;
+    typedef typename upstream_policy::pointer upstream_pointer;
+
+    upstream_policy upstream(policy);
+    upstream.deallocate(pointer_cast_traits<upstream_pointer>::reinterpret_pcast(mem), size / sizeof(unit_type));
+}
+
+} // namespace details
+
+} // namespace alloc_utility
+
+#endif // UPSTREAM_HPP
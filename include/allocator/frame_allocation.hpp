@@ -0,0 +1,297 @@
+#ifndef FRAME_ALLOCATION_HPP
+#define FRAME_ALLOCATION_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alloc_traits.hpp"
+#include "alloc_policies.hpp"
+#include "pointer_cast.hpp"
+#include "macro.hpp"
+#include "details/linear_storage.hpp"
+#include "details/upstream.hpp"
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// buffers of frames shared by copies of frame_allocation_policy and usage statistics of frames
+
+template <typename pointer, typename size_type>
+struct frame_arena
+{
+    struct frame
+    {
+        linear_storage<pointer, size_type> storage;
+        // memory allocated from base_policy when the buffer was exhausted, it is freed with the frame
+        std::vector<std::pair<pointer, size_type>> overflow;
+        size_type usage;
+    };
+
+    frame_arena(size_type size, size_type frames_count):
+        frames(frames_count)
+      , current(0)
+      , frame_size(size)
+      , frames_passed(0)
+      , peak_usage(0)
+      , overflows_count(0)
+    {
+        for (frame& f: frames) {
+            f.usage = 0;
+        }
+    }
+
+    std::vector<frame> frames;
+    size_type current;
+    size_type frame_size;
+    size_type frames_passed;
+    size_type peak_usage;
+    size_type overflows_count;
+};
+
+} // namespace details
+
+// frame_allocation_policy bump allocates objects from the buffer of the current frame,
+// there are frames_count buffers used in turn. next_frame() makes the oldest frame current
+// and frees all its memory at once, so objects live for frames_count - 1 calls of next_frame()
+// (i.e. for the current and the next tick with two frames). Deallocation of single objects does nothing.
+// Buffers are allocated from base_policy on the first allocation in the frame and kept until
+// the last copy of the policy is destroyed. Allocations which don't fit into the buffer are passed
+// to base_policy and freed when the frame is reused. Memory of base_policy should be aligned as by operator new.
+// Copies and rebinded copies of the policy share the frames and can't be used from different threads.
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+class frame_allocation_policy: public base_policy
+{
+    typedef typename std::pointer_traits<typename alloc_traits::pointer>::template rebind<std::uint8_t> byte_pointer;
+    typedef details::frame_arena<byte_pointer, typename alloc_traits::size_type> arena_type;
+
+public:
+
+    DECLARE_ALLOC_TRAITS(T, alloc_traits)
+    DECLARE_REBIND_ALLOC(frame_allocation_policy, T, alloc_traits, base_policy)
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    static const size_type DEFAULT_FRAME_SIZE = 65536;
+    static const size_type DEFAULT_FRAMES_COUNT = 2;
+
+    // frame_size is the size of the buffer of each frame in bytes
+
+    explicit frame_allocation_policy(size_type frame_size = DEFAULT_FRAME_SIZE,
+                                     size_type frames_count = DEFAULT_FRAMES_COUNT):
+        m_arena(std::make_shared<arena_type>(frame_size, frames_count))
+    {
+        assert(frame_size > 0);
+        assert(frames_count > 0);
+    }
+
+    frame_allocation_policy(const frame_allocation_policy& other) noexcept:
+        base_policy(other)
+      , m_arena(other.m_arena)
+    {}
+
+    frame_allocation_policy(frame_allocation_policy&& other) noexcept:
+        base_policy(std::move(other))
+      , m_arena(std::move(other.m_arena))
+    {}
+
+    template <typename U>
+    frame_allocation_policy(const rebind<U>& other) noexcept:
+        base_policy(other)
+      , m_arena(other.m_arena)
+    {}
+
+    ~frame_allocation_policy()
+    {
+        if (m_arena && m_arena.use_count() == 1) {
+            for (auto& f: m_arena->frames) {
+                release_frame(f);
+                if (f.storage.get_storage()) {
+                    upstream_deallocate(f.storage.get_storage(), f.storage.storage_size());
+                }
+            }
+        }
+    }
+
+    frame_allocation_policy& operator=(frame_allocation_policy other) noexcept
+    {
+        other.swap(*this);
+        return *this;
+    }
+
+    void swap(frame_allocation_policy& other) noexcept
+    {
+        using std::swap;
+        swap(static_cast<base_policy&>(*this), static_cast<base_policy&>(other));
+        swap(m_arena, other.m_arena);
+    }
+
+    size_type frames_count() const noexcept
+    {
+        return m_arena->frames.size();
+    }
+
+    // size of the buffer of each frame in bytes
+
+    size_type frame_size() const noexcept
+    {
+        return m_arena->frame_size;
+    }
+
+    // number of next_frame() calls
+
+    size_type frame_number() const noexcept
+    {
+        return m_arena->frames_passed;
+    }
+
+    // bytes allocated in the current frame including padding and allocations passed to base_policy
+
+    size_type frame_usage() const noexcept
+    {
+        return current_frame().usage;
+    }
+
+    // the largest usage of frames finished by next_frame(), it is a hint for the frame size
+
+    size_type peak_frame_usage() const noexcept
+    {
+        return m_arena->peak_usage;
+    }
+
+    // number of allocations which didn't fit into the buffer of their frame
+
+    size_type overflows_count() const noexcept
+    {
+        return m_arena->overflows_count;
+    }
+
+    // finishes the current frame and makes the oldest frame current,
+    // all objects allocated in the oldest frame become invalid
+
+    void next_frame()
+    {
+        arena_type& arena = *m_arena;
+        arena.peak_usage = std::max(arena.peak_usage, current_frame().usage);
+        ++arena.frames_passed;
+        arena.current = (arena.current + 1) % arena.frames.size();
+        typename arena_type::frame& f = arena.frames[arena.current];
+        release_frame(f);
+        f.storage.rewind(0);
+        f.usage = 0;
+    }
+
+    pointer allocate(size_type n, const pointer& ptr, const const_void_pointer& hint = nullptr)
+    {
+        if (ptr) {
+            return ptr;
+        }
+        typename arena_type::frame& f = current_frame();
+        size_type size = n * sizeof(T);
+        if (!f.storage.get_storage() && size <= m_arena->frame_size) {
+            byte_pointer mem = details::upstream_allocate<std::uint8_t, byte_pointer>(
+                static_cast<const base_policy&>(*this), m_arena->frame_size, hint);
+            if (mem) {
+                f.storage.set_storage(mem, m_arena->frame_size);
+            }
+        }
+        if (f.storage.is_memory_available(size, alignof(T))) {
+            size_type marker = f.storage.get_marker();
+            byte_pointer mem = f.storage.allocate(size, alignof(T));
+            f.usage += f.storage.get_marker() - marker;
+            return pointer_cast_traits<pointer>::reinterpret_pcast(mem);
+        }
+        return allocate_overflow(f, n, hint);
+    }
+
+    void deallocate(const pointer& ptr, size_type n)
+    {
+        ALLOC_UNUSED(ptr);
+        ALLOC_UNUSED(n);
+    }
+
+    bool operator==(const frame_allocation_policy& other) const noexcept
+    {
+        return m_arena == other.m_arena;
+    }
+
+    bool operator!=(const frame_allocation_policy& other) const noexcept
+    {
+        return !operator==(other);
+    }
+
+    template <typename, typename, typename>
+    friend class frame_allocation_policy;
+
+private:
+
+    typename arena_type::frame& current_frame() const noexcept
+    {
+        return m_arena->frames[m_arena->current];
+    }
+
+    // memory shared by copies is requested from base_policy in bytes, so a copy of any type releases it
+
+    void upstream_deallocate(const byte_pointer& mem, size_type size)
+    {
+        details::upstream_deallocate<std::uint8_t>(static_cast<const base_policy&>(*this), mem, size);
+    }
+
+    // over-aligned objects are padded since memory of base_policy is aligned as by operator new
+
+    pointer allocate_overflow(typename arena_type::frame& f, size_type n, const const_void_pointer& hint)
+    {
+        const size_type padding = alignof(T) > alignof(std::max_align_t) ? alignof(T) - 1 : 0;
+        size_type size = n * sizeof(T) + padding;
+        byte_pointer mem = details::upstream_allocate<std::uint8_t, byte_pointer>(
+            static_cast<const base_policy&>(*this), size, hint);
+        if (!mem) {
+            return pointer(nullptr);
+        }
+        f.overflow.emplace_back(mem, size);
+        f.usage += n * sizeof(T);
+        ++m_arena->overflows_count;
+        std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(&*mem);
+        size_type offset = (alignof(T) - (addr & (alignof(T) - 1))) & (alignof(T) - 1);
+        return pointer_cast_traits<pointer>::reinterpret_pcast(mem + offset);
+    }
+
+    void release_frame(typename arena_type::frame& f)
+    {
+        for (auto& mem: f.overflow) {
+            upstream_deallocate(mem.first, mem.second);
+        }
+        f.overflow.clear();
+    }
+
+    std::shared_ptr<arena_type> m_arena;
+};
+
+template <typename T, typename alloc_traits, typename base_policy>
+const typename alloc_traits::size_type frame_allocation_policy<T, alloc_traits, base_policy>::DEFAULT_FRAME_SIZE;
+
+template <typename T, typename alloc_traits, typename base_policy>
+const typename alloc_traits::size_type frame_allocation_policy<T, alloc_traits, base_policy>::DEFAULT_FRAMES_COUNT;
+
+template <typename T, typename alloc_traits, typename base_policy>
+void swap(frame_allocation_policy<T, alloc_traits, base_policy>& alloc1,
+          frame_allocation_policy<T, alloc_traits, base_policy>& alloc2) noexcept
+{
+    alloc1.swap(alloc2);
+}
+
+} // namespace alloc_utility
+
+#endif // FRAME_ALLOCATION_HPP
@@ -1,55 +1,133 @@
 #ifndef LINEAR_ALLOCATION_HPP
 #define LINEAR_ALLOCATION_HPP
 
+#include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <type_traits>
 
 #include "alloc_traits.hpp"
 #include "alloc_policies.hpp"
 #include "pointer_cast.hpp"
+#include "details/concurrent_linear_storage.hpp"
 #include "details/linear_storage.hpp"
+#include "details/purge.hpp"
+#include "details/tlab_cache.hpp"
 
 namespace alloc_utility
 {
 
+// linear_traits configure basic_linear_allocation_policy, custom traits should derive from default_linear_traits
+
+struct default_linear_traits
+{
+    // if true the storage is details::concurrent_linear_storage: allocations, deallocations and try_resize
+    // are lock-free, so copies of the policy sharing the storage may allocate from different threads.
+    // set_storage, allocate_storage, rewind and purge still should not run concurrently with allocations.
+    // Otherwise the storage is details::linear_storage and can't be used from different threads
+    static const bool CONCURRENT = false;
+
+    // size of thread local allocation buffers (TLABs) in bytes, 0 disables them. TLABs require CONCURRENT.
+    // Each thread takes buffers of this size from the shared storage and allocates from them
+    // without touching the shared offset, so threads don't bounce its cache line.
+    // Requests larger than a quarter of the buffer are allocated from the storage directly.
+    // The rest of the buffer is wasted when it is replaced (see tlab_statistic),
+    // buffers are released with the storage and dropped by set_storage and rewind
+    static const std::size_t TLAB_SIZE = 0;
+};
+
+struct concurrent_linear_traits: public default_linear_traits
+{
+    static const bool CONCURRENT = true;
+};
+
+struct tlab_linear_traits: public concurrent_linear_traits
+{
+    static const std::size_t TLAB_SIZE = 16384;
+};
+
 template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename linear_traits = default_linear_traits,
           typename base_policy = default_allocation_policy<T, alloc_traits>>
-class linear_allocation_policy: public base_policy
+class basic_linear_allocation_policy: public base_policy
 {
     typedef typename std::pointer_traits<typename alloc_traits::pointer>::template rebind<std::uint8_t> byte_pointer;
-    typedef details::linear_storage<byte_pointer, typename alloc_traits::size_type> storage_type;
+    typedef typename std::conditional<linear_traits::CONCURRENT,
+                details::concurrent_linear_storage<byte_pointer, typename alloc_traits::size_type>,
+                details::linear_storage<byte_pointer, typename alloc_traits::size_type>
+            >::type storage_type;
+    typedef details::tlab_cache<byte_pointer, typename alloc_traits::size_type, storage_type> tlab_cache_type;
+    typedef typename tlab_cache_type::tlab tlab_type;
+    typedef std::integral_constant<bool, (linear_traits::TLAB_SIZE > 0)> uses_tlab;
+
+    static_assert(!uses_tlab::value || linear_traits::CONCURRENT, "Thread local buffers require concurrent storage");
 
 public:
 
     DECLARE_ALLOC_TRAITS(T, alloc_traits)
-    DECLARE_REBIND_ALLOC(linear_allocation_policy, T, alloc_traits, base_policy)
+    DECLARE_REBIND_ALLOC(basic_linear_allocation_policy, T, alloc_traits, linear_traits, base_policy)
+
+    typedef size_type marker_type;
+    typedef details::tlab_statistic<size_type> tlab_statistic_type;
 
     typedef std::true_type propagate_on_container_copy_assignment;
     typedef std::true_type propagate_on_container_move_assignment;
     typedef std::true_type propagate_on_container_swap;
 
-    linear_allocation_policy():
+    basic_linear_allocation_policy():
         m_storage(std::make_shared<storage_type>())
+      , m_alignment(1)
     {}
 
-    linear_allocation_policy(const linear_allocation_policy& other):
+    // allocations are aligned by the largest of alignment and alignof(T) (see set_alignment)
+
+    explicit basic_linear_allocation_policy(size_type alignment):
+        m_storage(std::make_shared<storage_type>())
+      , m_alignment(1)
+    {
+        set_alignment(alignment);
+    }
+
+    basic_linear_allocation_policy(const basic_linear_allocation_policy& other):
         m_storage(other.m_storage)
+      , m_alignment(other.m_alignment)
     {}
 
     template <typename U>
-    linear_allocation_policy(const rebind<U>& other):
+    basic_linear_allocation_policy(const rebind<U>& other):
         m_storage(other.m_storage)
+      , m_alignment(other.m_alignment)
     {}
 
-    ~linear_allocation_policy()
+    ~basic_linear_allocation_policy()
     {}
 
-    linear_allocation_policy& operator=(const linear_allocation_policy&) = delete;
-    linear_allocation_policy& operator=(linear_allocation_policy&&) = delete;
+    basic_linear_allocation_policy& operator=(const basic_linear_allocation_policy&) = delete;
+    basic_linear_allocation_policy& operator=(basic_linear_allocation_policy&&) = delete;
 
     bool is_memory_available(size_type size) const noexcept
     {
-        return m_storage->is_memory_available(size * sizeof(T));
+        return m_storage->is_memory_available(size * sizeof(T), alignment());
+    }
+
+    // alignment of allocations from the storage, it is never less than alignof(T).
+    // Copies of the policy share the storage but not the alignment, rebinded copies inherit it.
+    // Allocations passed to base_policy are aligned as base_policy does it
+
+    size_type alignment() const noexcept
+    {
+        return m_alignment > alignof(T) ? m_alignment : alignof(T);
+    }
+
+    // alignment should be a power of 2 not greater than the page size (i.e. 32 for AVX loads)
+
+    void set_alignment(size_type alignment) noexcept
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+        assert(alignment <= details::page_size());
+        m_alignment = alignment;
     }
 
     size_type storage_size() const noexcept
@@ -62,10 +140,13 @@ public:
         return pointer_cast_traits<pointer>::reinterpret_pcast(m_storage->get_storage());
     }
 
+    // storage of the user is never purged (see purge), it may be on the stack or mapped from a file.
+    // Setting the storage from allocate_storage again keeps it purged
+
     void set_storage(const pointer& ptr, size_type size) noexcept
     {
         m_storage->set_storage(pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr),
-                               size * sizeof(T));
+                               size * sizeof(T), false);
     }
 
     void allocate_storage(size_type size)
@@ -75,14 +156,81 @@ public:
                                size * sizeof(T));
     }
 
+    // returns the position of free memory in the storage, it is shared by copies of the policy.
+    // rewind(marker) frees all memory allocated from the storage after the marker was taken,
+    // memory allocated from base_policy still should be deallocated.
+    // Markers should be rewound in LIFO order (see linear_allocation_scope)
+    // and are invalidated by set_storage and allocate_storage
+
+    marker_type get_marker() const noexcept
+    {
+        return m_storage->get_marker();
+    }
+
+    void rewind(marker_type marker) noexcept
+    {
+        m_storage->rewind(marker);
+    }
+
+    // changes the number of objects of the last allocation from the storage in place,
+    // returns false (and the memory stays the same) if it isn't the last allocation or the storage is exhausted
+
+    bool try_resize(const pointer& ptr, size_type old_n, size_type new_n) noexcept
+    {
+        byte_pointer mem = pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr);
+        tlab_type* tlab = local_tlab(uses_tlab());
+        if (tlab && tlab->buffer().try_resize(mem, old_n * sizeof(T), new_n * sizeof(T))) {
+            tlab->statistic().register_use(new_n * sizeof(T));
+            tlab->statistic().register_release(old_n * sizeof(T));
+            return true;
+        }
+        return m_storage->try_resize(mem, old_n * sizeof(T), new_n * sizeof(T));
+    }
+
+    // grows the last allocation in place (see try_resize)
+
+    bool expand(const pointer& ptr, size_type old_n, size_type new_n) noexcept
+    {
+        assert(new_n >= old_n);
+        return try_resize(ptr, old_n, new_n);
+    }
+
+    // usage of thread local buffers of the calling thread (see linear_traits::TLAB_SIZE),
+    // it is empty if buffers are disabled or the thread didn't allocate from the storage
+
+    tlab_statistic_type tlab_statistic() const
+    {
+        tlab_type* tlab = local_tlab(uses_tlab());
+        return tlab ? tlab->statistic() : tlab_statistic_type();
+    }
+
+    // gives physical memory of the free part of the storage which was used before back to the system
+    // (see details::purge_pages) if the storage was allocated by allocate_storage
+    // and there were no allocations from it for decay time,
+    // the storage stays the same. The time is counted from the first call which finds such memory,
+    // so it should be called periodically. Returns the number of purged bytes,
+    // they are reported to base_policy::notify_purge
+
+    size_type purge(std::chrono::milliseconds decay = std::chrono::milliseconds(0), bool lazy = false)
+    {
+        size_type purged = m_storage->purge(details::purge_clock(), static_cast<std::uint32_t>(decay.count()),
+                                            [lazy](const byte_pointer& mem, size_type size) {
+                                                return details::purge_pages(&*mem, size, lazy);
+                                            });
+        if (purged > 0) {
+            base_policy::notify_purge(purged);
+        }
+        return purged;
+    }
+
     pointer allocate(size_type n, const pointer& ptr, const const_void_pointer& hint = nullptr)
     {
         if (ptr) {
             return ptr;
         }
-        if (is_memory_available(n)) {
-            return pointer_cast_traits<pointer>
-                    ::reinterpret_pcast(m_storage->allocate(n * sizeof(T)));
+        byte_pointer mem = allocate_from_storage(n * sizeof(T), uses_tlab());
+        if (mem) {
+            return pointer_cast_traits<pointer>::reinterpret_pcast(mem);
         }
         return base_policy::allocate(n, ptr, hint);
     }
@@ -92,27 +240,133 @@ public:
         if (!ptr) {
             return;
         }
-        if (m_storage->is_owned(pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr))) {
+        byte_pointer mem = pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr);
+        if (m_storage->is_owned(mem)) {
+            // only the last allocation is given back to the storage
+            tlab_type* tlab = local_tlab(uses_tlab());
+            if (tlab && tlab->buffer().free_last(mem, n * sizeof(T))) {
+                tlab->statistic().register_release(n * sizeof(T));
+                return;
+            }
+            m_storage->free_last(mem, n * sizeof(T));
             return;
         }
         base_policy::deallocate(ptr, n);
     }
 
-    bool operator==(const linear_allocation_policy& other) const noexcept
+    bool operator==(const basic_linear_allocation_policy& other) const noexcept
     {
         return m_storage == other.m_storage;
     }
 
-    bool operator!=(const linear_allocation_policy& other) const noexcept
+    bool operator!=(const basic_linear_allocation_policy& other) const noexcept
     {
         return !operator==(other);
     }
 
-    template <typename, typename, typename>
-    friend class linear_allocation_policy;
+    template <typename, typename, typename, typename>
+    friend class basic_linear_allocation_policy;
 
 private:
+
+    byte_pointer allocate_from_storage(size_type size, std::false_type) noexcept
+    {
+        return m_storage->try_allocate(size, alignment());
+    }
+
+    byte_pointer allocate_from_storage(size_type size, std::true_type)
+    {
+        tlab_cache_type* cache = tlab_cache_type::instance();
+        if (!cache || size > linear_traits::TLAB_SIZE / 4) {
+            return m_storage->try_allocate(size, alignment());
+        }
+        tlab_type& tlab = cache->get_tlab(m_storage);
+        if (tlab.is_outdated(*m_storage)) {
+            tlab.drop_buffer(*m_storage);
+        }
+        size_type marker = tlab.buffer().get_marker();
+        byte_pointer mem = tlab.buffer().try_allocate(size, alignment());
+        if (!mem) {
+            // buffers are aligned by cache lines, so buffers of different threads don't share them
+            byte_pointer buffer = m_storage->try_allocate(linear_traits::TLAB_SIZE, CACHE_LINE_SIZE);
+            if (!buffer) {
+                return m_storage->try_allocate(size, alignment());
+            }
+            tlab.set_buffer(*m_storage, buffer, linear_traits::TLAB_SIZE);
+            marker = 0;
+            mem = tlab.buffer().try_allocate(size, alignment());
+            if (!mem) {
+                return m_storage->try_allocate(size, alignment());
+            }
+        }
+        tlab.statistic().register_use(tlab.buffer().get_marker() - marker);
+        return mem;
+    }
+
+    // buffer of the calling thread which is valid for the storage or nullptr
+
+    tlab_type* local_tlab(std::false_type) const noexcept
+    {
+        return nullptr;
+    }
+
+    tlab_type* local_tlab(std::true_type) const noexcept
+    {
+        tlab_cache_type* cache = tlab_cache_type::instance();
+        if (!cache) {
+            return nullptr;
+        }
+        tlab_type* tlab = cache->find_tlab(m_storage.get());
+        return (tlab && !tlab->is_outdated(*m_storage)) ? tlab : nullptr;
+    }
+
     std::shared_ptr<storage_type> m_storage;
+    size_type m_alignment;
+};
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+using linear_allocation_policy = basic_linear_allocation_policy<T, alloc_traits, default_linear_traits, base_policy>;
+
+// linear policy which copies may allocate from the shared storage in different threads
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+using concurrent_linear_allocation_policy =
+    basic_linear_allocation_policy<T, alloc_traits, concurrent_linear_traits, base_policy>;
+
+// concurrent linear policy which threads allocate from their own buffers carved from the shared storage
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+using tlab_linear_allocation_policy =
+    basic_linear_allocation_policy<T, alloc_traits, tlab_linear_traits, base_policy>;
+
+// linear_allocation_scope takes a marker of the linear allocation policy (or of an allocator with it)
+// and rewinds the storage to it when the scope ends, so nested scopes free their temporaries in LIFO order.
+// Objects allocated inside the scope shouldn't be used after it
+
+template <typename linear_alloc>
+class linear_allocation_scope
+{
+public:
+
+    explicit linear_allocation_scope(linear_alloc& alloc) noexcept:
+        m_alloc(alloc)
+      , m_marker(alloc.get_marker())
+    {}
+
+    linear_allocation_scope(const linear_allocation_scope&) = delete;
+    linear_allocation_scope& operator=(const linear_allocation_scope&) = delete;
+
+    ~linear_allocation_scope()
+    {
+        m_alloc.rewind(m_marker);
+    }
+
+private:
+    linear_alloc& m_alloc;
+    typename linear_alloc::marker_type m_marker;
 };
 
 } // namespace alloc_utility
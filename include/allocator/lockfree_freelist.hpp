@@ -0,0 +1,216 @@
+#ifndef LOCKFREE_FREELIST_HPP
+#define LOCKFREE_FREELIST_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "alloc_traits.hpp"
+#include "alloc_policies.hpp"
+#include "macro.hpp"
+#include "details/lockfree_stack.hpp"
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// stacks shared by copies and rebinded copies of lockfree_freelist_policy, one per size and alignment of objects.
+// A stack is emptied and erased when the last policy using it is destroyed,
+// so no thread may pop from it while its blocks are given back
+
+struct freelist_registry
+{
+    struct freelist
+    {
+        freelist(std::size_t obj_size, std::size_t obj_align) noexcept:
+            size(obj_size)
+          , align(obj_align)
+          , ref_count(0)
+        {}
+
+        std::size_t size;
+        std::size_t align;
+        lockfree_stack stack;
+        std::atomic<long> ref_count;
+    };
+
+    freelist* acquire(std::size_t size, std::size_t align)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = freelists.begin();
+        while (it != freelists.end() && (it->size != size || it->align != align)) {
+            ++it;
+        }
+        if (it == freelists.end()) {
+            it = freelists.emplace(freelists.end(), size, align);
+        }
+        it->ref_count.fetch_add(1, std::memory_order_relaxed);
+        return &*it;
+    }
+
+    // release(mem) is called for every block of the stack if the policy was the last one using it
+
+    template <typename Release>
+    void release(freelist* fl, Release&& release) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fl->ref_count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        for (void* mem = fl->stack.pop(); mem; mem = fl->stack.pop()) {
+            release(mem);
+        }
+        for (auto it = freelists.begin(); it != freelists.end(); ++it) {
+            if (&*it == fl) {
+                freelists.erase(it);
+                break;
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::list<freelist> freelists;
+};
+
+} // namespace details
+
+// lockfree_freelist_policy keeps single objects deallocated through it on a lock-free stack
+// and serves allocations of single objects from the stack before calling base_policy.
+// Copies and rebinded copies of the policy share the stacks (one per size and alignment of objects)
+// and may be used from different threads (as long as base_policy may be used so),
+// i.e. to recycle nodes of concurrent containers. Memory kept in a stack is returned to base_policy
+// when the last copy of the policy using the stack is destroyed.
+// Objects smaller than a pointer are not cached.
+// Instances compare equal if they share the stacks, default constructed instances are never equal.
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+class lockfree_freelist_policy: public base_policy
+{
+    typedef details::freelist_registry registry_type;
+    typedef registry_type::freelist freelist;
+
+public:
+
+    DECLARE_ALLOC_TRAITS(T, alloc_traits)
+    DECLARE_REBIND_ALLOC(lockfree_freelist_policy, T, alloc_traits, base_policy)
+
+    static const bool IS_CACHEABLE = sizeof(T) >= sizeof(void*) && alignof(T) >= alignof(void*);
+
+    lockfree_freelist_policy():
+        m_registry(std::make_shared<registry_type>())
+      , m_freelist(m_registry->acquire(sizeof(T), alignof(T)))
+    {}
+
+    lockfree_freelist_policy(const lockfree_freelist_policy& other) noexcept:
+        base_policy(other)
+      , m_registry(other.m_registry)
+      , m_freelist(other.m_freelist)
+    {
+        m_freelist->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // moved-from policy keeps sharing the stack, so it remains usable
+
+    lockfree_freelist_policy(lockfree_freelist_policy&& other) noexcept:
+        base_policy(std::move(other))
+      , m_registry(other.m_registry)
+      , m_freelist(other.m_freelist)
+    {
+        m_freelist->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template <typename U>
+    lockfree_freelist_policy(const rebind<U>& other):
+        base_policy(other)
+      , m_registry(other.m_registry)
+      , m_freelist(m_registry->acquire(sizeof(T), alignof(T)))
+    {}
+
+    // memory kept in the stack is returned to base_policy of the last destroyed copy using it
+
+    ~lockfree_freelist_policy()
+    {
+        m_registry->release(m_freelist, [this](void* mem) {
+            this->base_policy::deallocate(static_cast<pointer>(mem), 1);
+        });
+    }
+
+    lockfree_freelist_policy& operator=(lockfree_freelist_policy other) noexcept
+    {
+        other.swap(*this);
+        return *this;
+    }
+
+    void swap(lockfree_freelist_policy& other) noexcept
+    {
+        using std::swap;
+        swap(static_cast<base_policy&>(*this), static_cast<base_policy&>(other));
+        swap(m_registry, other.m_registry);
+        swap(m_freelist, other.m_freelist);
+    }
+
+    pointer allocate(size_type n, const pointer& ptr, const_void_pointer hint = nullptr)
+    {
+        if (ptr) {
+            return ptr;
+        }
+        if (IS_CACHEABLE && n == 1) {
+            void* mem = m_freelist->stack.pop();
+            if (mem) {
+                return static_cast<pointer>(mem);
+            }
+        }
+        return base_policy::allocate(n, ptr, hint);
+    }
+
+    void deallocate(const pointer& ptr, size_type n)
+    {
+        if (IS_CACHEABLE && ptr && n == 1) {
+            m_freelist->stack.push(static_cast<void*>(ptr));
+            return;
+        }
+        base_policy::deallocate(ptr, n);
+    }
+
+    bool is_lock_free() const noexcept
+    {
+        return m_freelist->stack.is_lock_free();
+    }
+
+    bool operator==(const lockfree_freelist_policy& other) const noexcept
+    {
+        return m_registry == other.m_registry;
+    }
+
+    bool operator!=(const lockfree_freelist_policy& other) const noexcept
+    {
+        return !operator==(other);
+    }
+
+    template <typename, typename, typename>
+    friend class lockfree_freelist_policy;
+
+private:
+    std::shared_ptr<registry_type> m_registry;
+    freelist* m_freelist;
+};
+
+template <typename T, typename alloc_traits, typename base_policy>
+const bool lockfree_freelist_policy<T, alloc_traits, base_policy>::IS_CACHEABLE;
+
+template <typename T, typename alloc_traits, typename base_policy>
+void swap(lockfree_freelist_policy<T, alloc_traits, base_policy>& alloc1,
+          lockfree_freelist_policy<T, alloc_traits, base_policy>& alloc2) noexcept
+{
+    alloc1.swap(alloc2);
+}
+
+} // namespace alloc_utility
+
+#endif // LOCKFREE_FREELIST_HPP
@@ -0,0 +1,226 @@
+#ifndef MONOTONIC_ALLOCATION_HPP
+#define MONOTONIC_ALLOCATION_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+#include "alloc_traits.hpp"
+#include "alloc_policies.hpp"
+#include "pointer_cast.hpp"
+#include "details/linear_arena.hpp"
+#include "details/upstream.hpp"
+
+namespace alloc_utility
+{
+
+namespace details
+{
+
+// regions shared by copies of monotonic_allocation_policy, the sizes of the first and of the next region
+
+template <typename pointer, typename size_type>
+struct monotonic_arena
+{
+    explicit monotonic_arena(size_type region_size) noexcept:
+        first_region_size(region_size)
+      , next_region_size(region_size)
+    {}
+
+    linear_arena<pointer, size_type> arena;
+    size_type first_region_size;
+    size_type next_region_size;
+};
+
+} // namespace details
+
+// monotonic_allocation_policy bump allocates objects from a chain of regions obtained from base_policy.
+// When the current region is exhausted a new one twice as large as the previous is allocated
+// (or larger if the request doesn't fit into it), so the number of regions grows logarithmically.
+// Deallocation frees only the last allocation of the current region, so memory of LIFO temporaries is reused.
+// Memory of all regions is given back to base_policy at once by release() or when the last copy of the policy is destroyed.
+// Copies and rebinded copies of the policy share the regions and can't be used from different threads.
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+class monotonic_allocation_policy: public base_policy
+{
+    typedef typename std::pointer_traits<typename alloc_traits::pointer>::template rebind<std::uint8_t> byte_pointer;
+    typedef details::monotonic_arena<byte_pointer, typename alloc_traits::size_type> arena_type;
+
+public:
+
+    DECLARE_ALLOC_TRAITS(T, alloc_traits)
+    DECLARE_REBIND_ALLOC(monotonic_allocation_policy, T, alloc_traits, base_policy)
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    static const size_type DEFAULT_REGION_SIZE = 4096;
+
+    // region_size is the size of the first region in bytes
+
+    explicit monotonic_allocation_policy(size_type region_size = DEFAULT_REGION_SIZE):
+        m_arena(std::make_shared<arena_type>(region_size))
+    {
+        assert(region_size > 0);
+    }
+
+    monotonic_allocation_policy(const monotonic_allocation_policy& other) noexcept:
+        base_policy(other)
+      , m_arena(other.m_arena)
+    {}
+
+    monotonic_allocation_policy(monotonic_allocation_policy&& other) noexcept:
+        base_policy(std::move(other))
+      , m_arena(std::move(other.m_arena))
+    {}
+
+    template <typename U>
+    monotonic_allocation_policy(const rebind<U>& other) noexcept:
+        base_policy(other)
+      , m_arena(other.m_arena)
+    {}
+
+    ~monotonic_allocation_policy()
+    {
+        if (m_arena && m_arena.use_count() == 1) {
+            release();
+        }
+    }
+
+    monotonic_allocation_policy& operator=(monotonic_allocation_policy other) noexcept
+    {
+        other.swap(*this);
+        return *this;
+    }
+
+    void swap(monotonic_allocation_policy& other) noexcept
+    {
+        using std::swap;
+        swap(static_cast<base_policy&>(*this), static_cast<base_policy&>(other));
+        swap(m_arena, other.m_arena);
+    }
+
+    size_type regions_count() const noexcept
+    {
+        return m_arena->arena.regions_count();
+    }
+
+    // total size of regions in bytes
+
+    size_type total_size() const noexcept
+    {
+        return m_arena->arena.total_size();
+    }
+
+    // returns true if the pointer is inside one of the regions
+
+    bool is_owned(const pointer& ptr) const noexcept
+    {
+        return m_arena->arena.is_owned(pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr));
+    }
+
+    // changes the number of objects of the last allocation in place, returns false if it isn't the last
+    // allocation or the current region is exhausted
+
+    bool try_resize(const pointer& ptr, size_type old_n, size_type new_n) noexcept
+    {
+        return m_arena->arena.try_resize(pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr),
+                                         old_n * sizeof(T), new_n * sizeof(T));
+    }
+
+    bool expand(const pointer& ptr, size_type old_n, size_type new_n) noexcept
+    {
+        assert(new_n >= old_n);
+        return try_resize(ptr, old_n, new_n);
+    }
+
+    // gives all regions back to base_policy, objects allocated by any copy of the policy become invalid.
+    // The next region has the size of the first one
+
+    void release()
+    {
+        m_arena->arena.release([this](const byte_pointer& mem, size_type size) {
+            details::upstream_deallocate<std::uint8_t>(static_cast<const base_policy&>(*this), mem, size);
+        });
+        m_arena->next_region_size = m_arena->first_region_size;
+    }
+
+    pointer allocate(size_type n, const pointer& ptr, const const_void_pointer& hint = nullptr)
+    {
+        if (ptr) {
+            return ptr;
+        }
+        size_type size = n * sizeof(T);
+        if (!m_arena->arena.is_memory_available(size, alignof(T)) && !add_region(size, hint)) {
+            return pointer(nullptr);
+        }
+        return pointer_cast_traits<pointer>::reinterpret_pcast(m_arena->arena.allocate(size, alignof(T)));
+    }
+
+    void deallocate(const pointer& ptr, size_type n)
+    {
+        if (!ptr) {
+            return;
+        }
+        byte_pointer mem = pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr);
+        if (m_arena->arena.is_owned(mem)) {
+            // only the last allocation is given back to the arena
+            m_arena->arena.free_last(mem, n * sizeof(T));
+            return;
+        }
+        base_policy::deallocate(ptr, n);
+    }
+
+    bool operator==(const monotonic_allocation_policy& other) const noexcept
+    {
+        return m_arena == other.m_arena;
+    }
+
+    bool operator!=(const monotonic_allocation_policy& other) const noexcept
+    {
+        return !operator==(other);
+    }
+
+    template <typename, typename, typename>
+    friend class monotonic_allocation_policy;
+
+private:
+
+    // returns false if base_policy has no memory
+
+    bool add_region(size_type size, const const_void_pointer& hint)
+    {
+        // regions are shared by rebinded copies, so they are allocated in bytes and padded for alignment
+        size_type region_size = std::max(m_arena->next_region_size, size + alignof(T) - 1);
+        byte_pointer mem = details::upstream_allocate<std::uint8_t, byte_pointer>(
+            static_cast<const base_policy&>(*this), region_size, hint);
+        if (!mem) {
+            return false;
+        }
+        m_arena->arena.add_region(mem, region_size);
+        m_arena->next_region_size *= 2;
+        return true;
+    }
+
+    std::shared_ptr<arena_type> m_arena;
+};
+
+template <typename T, typename alloc_traits, typename base_policy>
+const typename alloc_traits::size_type monotonic_allocation_policy<T, alloc_traits, base_policy>::DEFAULT_REGION_SIZE;
+
+template <typename T, typename alloc_traits, typename base_policy>
+void swap(monotonic_allocation_policy<T, alloc_traits, base_policy>& alloc1,
+          monotonic_allocation_policy<T, alloc_traits, base_policy>& alloc2) noexcept
+{
+    alloc1.swap(alloc2);
+}
+
+} // namespace alloc_utility
+
+#endif // MONOTONIC_ALLOCATION_HPP
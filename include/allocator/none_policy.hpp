@@ -49,6 +49,14 @@ public:
         ALLOC_UNUSED(n);
         return;
     }
+
+    // called by policies which give physical memory of size bytes back to the system
+    // without deallocating it (see details::purge_pages)
+
+    void notify_purge(size_type size) noexcept
+    {
+        ALLOC_UNUSED(size);
+    }
 };
 
 }
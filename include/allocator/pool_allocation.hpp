@@ -1,104 +1,306 @@
 #ifndef POOL_ALLOCATION_HPP
 #define POOL_ALLOCATION_HPP
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <type_traits>
 #include <utility>
 
 #include "alloc_traits.hpp"
 #include "alloc_policies.hpp"
 #include "pointer_cast.hpp"
 #include "macro.hpp"
+#include "pool_growth.hpp"
+#include "details/lockfree_stack.hpp"
 #include "details/memory_pool.hpp"
+#include "details/purge.hpp"
+#include "details/thread_cache.hpp"
+#include "details/upstream.hpp"
 
 namespace alloc_utility
 {
 
+// default parameters of pool allocation.
+// To customize the pool derive from this struct and redefine required members, i.e.
+//
+// struct wide_pool_traits: public default_pool_traits
+// {
+//     typedef std::uint16_t chunk_index_type;
+// };
+
+struct default_pool_traits
+{
+    // type of indices of objects inside chunks of the pool.
+    // It limits the number of objects in one chunk by std::numeric_limits<chunk_index_type>::max(),
+    // and wider indices reduce the number of chunks (and therefore metadata) of large pools.
+    // Every pool slot occupies at least sizeof(chunk_index_type) bytes,
+    // so objects smaller than that are stored in slots of this minimum size.
+    typedef std::uint8_t chunk_index_type;
+
+    // type of mutex guarding pools shared by copies of the policy.
+    // With details::null_mutex the policy can't be used from different threads, but it pays nothing for locking.
+    // With a real mutex (i.e. std::mutex) copies of the policy may be used from different threads:
+    // each size class (pool) has its own lock and the manager lock is taken only to add memory blocks,
+    // create or destroy pools and deallocate objects of other size classes.
+    typedef details::null_mutex mutex_type;
+
+    // strategy choosing the size of memory blocks added to the exhausted pool (see pool_growth.hpp).
+    // By default every block has the block size of the policy
+    typedef fixed_pool_growth growth_strategy;
+
+    // capacity of per thread cache of free objects of each pool, 0 disables caching.
+    // Caching requires mutex_type to be a real mutex.
+    // Each thread allocates from its own cache, which is refilled from and flushed to the shared pool
+    // by batches of (THREAD_CACHE_SIZE + 1) / 2 objects under the lock of the pool.
+    // Caches are returned to the pools on thread exit.
+    // Objects should be deallocated by a policy for the same type they were allocated by
+    // (as it's required from standard allocators).
+    static const std::size_t THREAD_CACHE_SIZE = 0;
+
+    // if true deallocation of single objects never takes locks: objects are pushed onto a lock-free list
+    // of their pool and are returned to the pool in batch by the allocation which finds the pool exhausted.
+    // It suits objects allocated by one thread and deallocated by another (i.e. messages in a pipeline).
+    // Requires mutex_type to be a real mutex and has the same deallocation requirement as the thread caching.
+    // Slots of the pool are at least sizeof(void*) bytes and are aligned to alignof(void*).
+    // Single objects of base_policy deallocated through the policy are given back to base_policy
+    // after they are collected, so they should be as large and aligned as well.
+    static const bool REMOTE_FREE = false;
+
+    // if greater than 1 slots of the pool are padded to a multiple of SLOT_ALIGNMENT (a power of 2)
+    // and memory blocks of the pool are aligned by it, so slots start on SLOT_ALIGNMENT boundaries.
+    // With CACHE_LINE_SIZE each object occupies cache lines of its own and objects used by different threads
+    // (i.e. per thread counters) don't slow each other down by false sharing.
+    // Blocks are over-allocated from base_policy if alignof(T) is less than SLOT_ALIGNMENT
+    static const std::size_t SLOT_ALIGNMENT = 1;
+
+    // if greater than 1 consecutive memory blocks of the pool start at offsets rotating over CACHE_COLORS
+    // cache lines from the start of upstream memory (slab coloring), so the first objects of blocks
+    // are spread over different cache sets even if base_policy returns page aligned memory.
+    // Each block is over-allocated from base_policy by CACHE_COLORS - 1 cache lines
+    static const std::size_t CACHE_COLORS = 0;
+
+    // if true allocation prefetches the free object which is likely returned by the next allocation.
+    // It pays off when free objects are scattered over cold memory (i.e. after churn)
+    // and allocations are interleaved with other work, otherwise it's just an extra instruction
+    static const bool PREFETCH = false;
+
+    // if not 0 the pool returns its empty memory blocks to base_policy (as by trim(AUTO_TRIM_SPARE_BLOCKS))
+    // once free objects exceed AUTO_TRIM_PERCENT percent of its capacity.
+    // The condition is checked by deallocations which return objects to the pool,
+    // remote deallocations and deallocations to the thread cache don't trigger it
+    static const std::size_t AUTO_TRIM_PERCENT = 0;
+
+    // number of empty memory blocks kept by automatic trimming,
+    // they absorb allocations following the trimming without growing the pool again
+    static const std::size_t AUTO_TRIM_SPARE_BLOCKS = 1;
+
+    // if not 0 physical memory of chunks which have no allocated objects for PURGE_DECAY_MS milliseconds
+    // is given back to the system (as by purge()), the memory stays in the pool.
+    // Idle chunks are looked for by deallocations which return objects to the pool,
+    // at most once per PURGE_DECAY_MS, so pools without deallocations should be purged explicitly
+    static const std::size_t PURGE_DECAY_MS = 0;
+
+    // if true purged memory is reclaimed by the system lazily, only under memory pressure (MADV_FREE).
+    // It is cheaper, but RSS of the process doesn't drop right after the purge
+    static const bool PURGE_LAZY = false;
+};
+
 template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename pool_traits = default_pool_traits,
           typename base_policy = default_allocation_policy<T, alloc_traits>>
-class pool_allocation_policy: public base_policy
+class basic_pool_allocation_policy: public base_policy
 {
     typedef typename std::pointer_traits<typename alloc_traits::pointer>::template rebind<std::uint8_t> byte_pointer;
-    typedef details::memory_pool<byte_pointer, typename alloc_traits::size_type> pool_type;
-    typedef details::pools_manager<byte_pointer, typename alloc_traits::size_type> pools_manager_type;
+    typedef typename pool_traits::chunk_index_type chunk_index_type;
+    typedef typename pool_traits::mutex_type mutex_type;
+    typedef typename pool_traits::growth_strategy growth_strategy;
+    typedef std::lock_guard<mutex_type> lock_guard;
+    typedef details::memory_pool<byte_pointer, typename alloc_traits::size_type, chunk_index_type> pool_type;
+    typedef details::pools_manager<byte_pointer, typename alloc_traits::size_type,
+                                   chunk_index_type, mutex_type> pools_manager_type;
+    typedef details::thread_cache<byte_pointer, typename alloc_traits::size_type, pools_manager_type> thread_cache_type;
+
+    static const std::size_t MIN_SLOT_SIZE = pool_type::memory_block_type::chunk_type::MIN_OBJ_SIZE;
+    static const std::size_t UNALIGNED_SLOT_SIZE = sizeof(T) > MIN_SLOT_SIZE ? sizeof(T) : MIN_SLOT_SIZE;
+    // lock-free list of remotely deallocated objects is threaded through them
+    static const std::size_t REMOTE_FREE_ALIGN = pool_traits::REMOTE_FREE ? details::lockfree_stack::NODE_ALIGNMENT : 1;
+    static const std::size_t SLOT_ALIGN = pool_traits::SLOT_ALIGNMENT > REMOTE_FREE_ALIGN
+                                            ? pool_traits::SLOT_ALIGNMENT : REMOTE_FREE_ALIGN;
+    static const std::size_t SLOT_SIZE_VALUE = (UNALIGNED_SLOT_SIZE + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+
+    // blocks are shared by rebinded copies of the policy with the same slot size, so their layout depends
+    // on the slot size and pool_traits only. Blocks are allocated from base_policy by units of UNIT_ALIGN bytes,
+    // it is the largest power of 2 dividing the slot size (but not larger than the fundamental alignment),
+    // so memory of base_policy is aligned for every type sharing the pool
+    static const std::size_t SLOT_SIZE_ALIGN = SLOT_SIZE_VALUE & (~SLOT_SIZE_VALUE + 1);
+    static const std::size_t UNIT_ALIGN = SLOT_SIZE_ALIGN < alignof(std::max_align_t)
+                                            ? SLOT_SIZE_ALIGN : alignof(std::max_align_t);
+    typedef details::upstream_unit<UNIT_ALIGN> upstream_unit;
+    // slots aligned stricter than units are aligned by the pool itself
+    static const bool ALIGNS_BLOCKS = SLOT_ALIGN > UNIT_ALIGN;
+    static const bool COLORS_BLOCKS = pool_traits::CACHE_COLORS > 1;
+    static const std::size_t COLOR_STEP = SLOT_ALIGN > CACHE_LINE_SIZE ? SLOT_ALIGN : CACHE_LINE_SIZE;
+
+    // blocks which don't start at upstream memory keep the upstream pointer and size right before them
+    struct block_header
+    {
+        byte_pointer mem;
+        typename alloc_traits::size_type size;
+    };
+
+    static const bool MOVES_BLOCKS = ALIGNS_BLOCKS || COLORS_BLOCKS;
+    static const std::size_t HEADER_SIZE = (sizeof(block_header) + UNIT_ALIGN - 1) / UNIT_ALIGN * UNIT_ALIGN;
+    static const std::size_t BLOCK_OVERHEAD = !MOVES_BLOCKS ? 0 :
+                                              HEADER_SIZE
+                                            + (ALIGNS_BLOCKS ? SLOT_ALIGN - UNIT_ALIGN : 0)
+                                            + (COLORS_BLOCKS ? (pool_traits::CACHE_COLORS - 1) * COLOR_STEP : 0);
+
+    static_assert(alignof(T) <= UNIT_ALIGN || alignof(T) <= SLOT_ALIGN,
+                  "Over-aligned types require pool_traits::SLOT_ALIGNMENT");
+    static_assert((SLOT_ALIGN & (SLOT_ALIGN - 1)) == 0, "pool_traits::SLOT_ALIGNMENT should be a power of 2");
 
 public:
 
     DECLARE_ALLOC_TRAITS(T, alloc_traits)
-    DECLARE_REBIND_ALLOC(pool_allocation_policy, T, alloc_traits, base_policy)
+    DECLARE_REBIND_ALLOC(basic_pool_allocation_policy, T, alloc_traits, pool_traits, base_policy)
 
     typedef std::true_type propagate_on_container_copy_assignment;
     typedef std::true_type propagate_on_container_move_assignment;
     typedef std::true_type propagate_on_container_swap;
 
-    static const size_type DEFAULT_BLOCK_SIZE = pool_type::memory_block_type::chunk_type::CHUNK_MAXSIZE;
+    typedef pool_traits pool_traits_type;
+
+    static const size_type DEFAULT_BLOCK_SIZE = std::numeric_limits<std::uint8_t>::max();
+
+    // deallocations from any thread don't take locks if pool_traits::REMOTE_FREE is true
+    static const bool REMOTE_FREE = pool_traits::REMOTE_FREE;
 
-    explicit pool_allocation_policy(size_type block_size = DEFAULT_BLOCK_SIZE):
+    // size of memory occupied by one object in the pool
+    static const size_type SLOT_SIZE = SLOT_SIZE_VALUE;
+
+    // copies of the policy may be used from different threads if pool_traits::mutex_type is a real mutex
+    static const bool THREAD_SAFE = pools_manager_type::THREAD_SAFE;
+
+    // policy caches objects per thread if pool_traits::THREAD_CACHE_SIZE > 0
+    static const bool THREAD_CACHING = (pool_traits::THREAD_CACHE_SIZE > 0);
+
+    // pool returns its empty blocks to base_policy automatically if pool_traits::AUTO_TRIM_PERCENT > 0
+    static const bool AUTO_TRIM = (pool_traits::AUTO_TRIM_PERCENT > 0);
+
+    // pool purges its idle memory automatically if pool_traits::PURGE_DECAY_MS > 0
+    static const bool AUTO_PURGE = (pool_traits::PURGE_DECAY_MS > 0);
+
+    static_assert(THREAD_SAFE || !THREAD_CACHING, "Thread caching requires pool_traits::mutex_type to be a real mutex");
+    static_assert(THREAD_SAFE || !REMOTE_FREE, "Remote free requires pool_traits::mutex_type to be a real mutex");
+
+    explicit basic_pool_allocation_policy(size_type block_size = DEFAULT_BLOCK_SIZE):
         m_manager(std::make_shared<pools_manager_type>())
-      , m_pool(m_manager->get_pool(sizeof(T)))
       , m_block_size(block_size)
-    {}
+      , m_growth()
+      , m_purge_countdown(PURGE_CHECK_PERIOD)
+    {
+        acquire_pool();
+    }
 
-    pool_allocation_policy(const pool_allocation_policy& other) noexcept:
+    basic_pool_allocation_policy(const basic_pool_allocation_policy& other) noexcept:
         base_policy(other)
       , m_manager(other.m_manager)
-      , m_pool(m_manager->get_pool(sizeof(T), std::nothrow))
+      , m_pool(other.m_pool)
+      , m_pool_id(other.m_pool_id)
+      , m_pool_mutex(other.m_pool_mutex)
       , m_block_size(other.m_block_size)
-    {}
+      , m_growth(other.m_growth)
+      , m_purge_countdown(PURGE_CHECK_PERIOD)
+    {
+        // other holds a reference to the pool, so it may be taken without the lock if the pool is indexed
+        if (SLOT_SIZE > pools_manager_type::MAX_INDEXED_OBJ_SIZE) {
+            lock_guard lock(m_manager->mutex());
+            m_manager->get_pool(SLOT_SIZE, std::nothrow);
+        } else {
+            m_manager->get_pool(SLOT_SIZE, std::nothrow);
+        }
+    }
 
-    pool_allocation_policy(pool_allocation_policy&& other) noexcept:
+    basic_pool_allocation_policy(basic_pool_allocation_policy&& other) noexcept:
         base_policy(std::move(other))
       , m_manager(std::move(other.m_manager))
       , m_pool(other.m_pool)
+      , m_pool_id(other.m_pool_id)
+      , m_pool_mutex(other.m_pool_mutex)
       , m_block_size(other.m_block_size)
+      , m_growth(other.m_growth)
+      , m_purge_countdown(PURGE_CHECK_PERIOD)
     {}
 
     template <typename U>
-    pool_allocation_policy(const rebind<U>& other):
+    basic_pool_allocation_policy(const rebind<U>& other):
         base_policy(other)
       , m_manager(other.m_manager)
-      , m_pool(m_manager->get_pool(sizeof(T)))
       , m_block_size(other.m_block_size)
-    {}
+      , m_growth(other.m_growth)
+      , m_purge_countdown(PURGE_CHECK_PERIOD)
+    {
+        acquire_pool();
+    }
 
-    ~pool_allocation_policy()
+    ~basic_pool_allocation_policy()
     {
         if (!m_manager) {
             return;
         }
-        m_manager->release_pool(sizeof(T));
-        if (m_manager->get_pool_ref_count(sizeof(T)) == 0) {
+        lock_guard lock(m_manager->mutex());
+        if (m_manager->release_pool(SLOT_SIZE) == 0) {
+            if (REMOTE_FREE) {
+                m_pool->collect_remote();
+                release_unowned(true);
+            }
+            thread_cache_type* cache = THREAD_CACHING ? thread_cache_type::instance() : nullptr;
+            if (cache) {
+                cache->erase_magazine(m_pool_id);
+            }
             typename pool_type::memory_blocks_range mb_range = m_pool->get_mem_blocks();
             for (auto it = mb_range.begin(); it != mb_range.end(); ++it) {
-                pointer ptr = pointer_cast_traits<pointer>::reinterpret_pcast(it->get_memory_ptr());
-                base_policy::deallocate(ptr, it->size());
+                release_mem_block(it->get_memory_ptr(), it->size());
             }
-            m_manager->erase_pool(sizeof(T));
+            m_manager->erase_pool(SLOT_SIZE);
         }
     }
 
-    pool_allocation_policy& operator=(pool_allocation_policy other) noexcept
+    basic_pool_allocation_policy& operator=(basic_pool_allocation_policy other) noexcept
     {
         other.swap(*this);
         return *this;
     }
 
-    void swap(pool_allocation_policy& other) noexcept
+    void swap(basic_pool_allocation_policy& other) noexcept
     {
         using std::swap;
         swap(static_cast<base_policy&>(*this), static_cast<base_policy&>(other));
         swap(m_manager, other.m_manager);
         swap(m_pool, other.m_pool);
+        swap(m_pool_id, other.m_pool_id);
+        swap(m_pool_mutex, other.m_pool_mutex);
         swap(m_block_size, other.m_block_size);
+        swap(m_growth, other.m_growth);
     }
 
     size_type capacity() const noexcept
     {
+        lock_guard lock(*m_pool_mutex);
         return m_pool->capacity();
     }
 
+    // block size passed to the growth strategy of the pool, with the default strategy
+    // it is the number of objects in every memory block added to the exhausted pool
+
     size_type block_size() const noexcept
     {
         return m_block_size;
@@ -112,13 +314,48 @@ public:
 
     void reserve(size_type new_capacity)
     {
-        if (new_capacity <= capacity()) {
+        lock_guard manager_lock(m_manager->mutex());
+        lock_guard pool_lock(*m_pool_mutex);
+        if (new_capacity <= m_pool->capacity()) {
             return;
         }
-        size_type cap_diff = new_capacity - capacity();
+        size_type cap_diff = new_capacity - m_pool->capacity();
         add_mem_block(cap_diff);
     }
 
+    // returns empty memory blocks of the pool to base_policy keeping at most spare_blocks of them,
+    // returns the number of objects by which the capacity of the pool is reduced.
+    // Objects kept in thread caches hold their blocks in use
+
+    size_type trim(size_type spare_blocks = 0)
+    {
+        lock_guard manager_lock(m_manager->mutex());
+        lock_guard pool_lock(*m_pool_mutex);
+        if (REMOTE_FREE) {
+            m_pool->collect_remote();
+        }
+        return m_manager->trim(m_pool, spare_blocks, [this](const byte_pointer& mem, size_type size) {
+            this->release_mem_block(mem, size);
+        });
+    }
+
+    void shrink_to_fit()
+    {
+        trim(0);
+    }
+
+    // gives physical memory of chunks of the pool which have no allocated objects for decay time
+    // back to the system (see details::purge_pages), the memory stays in the pool.
+    // The time is counted from the first call which finds a chunk empty, so it should be called periodically.
+    // Returns the number of purged bytes, they are reported to base_policy::notify_purge
+
+    size_type purge(std::chrono::milliseconds decay =
+                        std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(pool_traits::PURGE_DECAY_MS)))
+    {
+        lock_guard lock(*m_pool_mutex);
+        return purge_pool(details::purge_clock(), static_cast<std::uint32_t>(decay.count()));
+    }
+
     pointer allocate(size_type n, const pointer& ptr, const const_void_pointer& hint = nullptr)
     {
         if (ptr) {
@@ -127,61 +364,400 @@ public:
         if (n > 1 || n == 0) {
             return base_policy::allocate(n, ptr, hint);
         }
-        if (!m_pool->is_memory_available()) {
-            add_mem_block(m_block_size, hint);
+        release_unowned();
+        if (THREAD_CACHING) {
+            return pointer_cast_traits<pointer>::reinterpret_pcast(cached_allocate(hint));
         }
-        return pointer_cast_traits<pointer>::reinterpret_pcast(m_pool->allocate());
+        return pointer_cast_traits<pointer>::reinterpret_pcast(pool_allocate(hint));
     }
 
     void deallocate(const pointer& ptr, size_type n)
     {
         byte_pointer byte_ptr = pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr);
-        if (m_pool->is_owned(byte_ptr)) {
-            m_pool->deallocate(byte_ptr);
+        if (THREAD_CACHING && n == 1 && cached_deallocate(byte_ptr)) {
             return;
         }
-        for (auto it = m_manager->begin(); it != m_manager->end(); ++it) {
-            if (it->obj_size() != sizeof(T) && it->is_owned(byte_ptr)) {
-                it->deallocate(byte_ptr);
-                return;
-            }
+        if (REMOTE_FREE && n == 1) {
+            m_pool->remote_deallocate(byte_ptr);
+            return;
+        }
+        if (pool_deallocate(byte_ptr)) {
+            maintain_pool();
+            return;
         }
         base_policy::deallocate(ptr, n);
     }
 
-    bool operator==(const pool_allocation_policy& other) const noexcept
+    // allocates n single objects writing pointers to them into out, returns out past the last written pointer.
+    // The pool is locked once and grows at most by one block for the whole batch,
+    // so either all n objects are allocated or none of them (if base_policy throws).
+    // Objects are taken from the shared pool directly, bypassing the thread cache
+
+    template <typename OutputIt>
+    OutputIt allocate_batch(size_type n, OutputIt out)
+    {
+        release_unowned();
+        auto sink = [&out](const byte_pointer& ptr) {
+            *out = pointer_cast_traits<pointer>::reinterpret_pcast(ptr);
+            ++out;
+        };
+        {
+            lock_guard lock(*m_pool_mutex);
+            if (is_pool_memory_available(n)) {
+                m_pool->allocate_batch(n, sink);
+                return out;
+            }
+        }
+        lock_guard manager_lock(m_manager->mutex());
+        lock_guard pool_lock(*m_pool_mutex);
+        if (!is_pool_memory_available(n)) {
+            add_mem_block(std::max(next_block_size(), n - m_pool->available()));
+        }
+        m_pool->allocate_batch(n, sink);
+        return out;
+    }
+
+    // deallocates single objects pointed by [first, last) under one lock of the pool.
+    // Objects of other pools and of base_policy are deallocated one by one as by deallocate(ptr, 1)
+
+    template <typename InputIt>
+    void deallocate_batch(InputIt first, InputIt last)
+    {
+        while (first != last) {
+            {
+                lock_guard lock(*m_pool_mutex);
+                for (; first != last; ++first) {
+                    if (!m_pool->deallocate(pointer_cast_traits<byte_pointer>::reinterpret_pcast(*first))) {
+                        break;
+                    }
+                }
+            }
+            if (first != last) {
+                pointer ptr = *first;
+                if (!pool_deallocate(pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr))) {
+                    base_policy::deallocate(ptr, 1);
+                }
+                ++first;
+            }
+        }
+        maintain_pool();
+    }
+
+    bool operator==(const basic_pool_allocation_policy& other) const noexcept
     {
         return (m_manager == other.m_manager);
     }
 
-    bool operator!=(const pool_allocation_policy& other) const noexcept
+    bool operator!=(const basic_pool_allocation_policy& other) const noexcept
     {
         return !operator==(other);
     }
 
-    template <typename, typename, typename>
-    friend class pool_allocation_policy;
+    template <typename, typename, typename, typename>
+    friend class basic_pool_allocation_policy;
 
 private:
 
+    // size of memory of base_policy in bytes for a memory block of size objects
+
+    static size_type upstream_size(size_type size) noexcept
+    {
+        return size * SLOT_SIZE + BLOCK_OVERHEAD;
+    }
+
+    static const size_type THREAD_CACHE_BATCH = (pool_traits::THREAD_CACHE_SIZE + 1) / 2;
+
+    static const size_type PURGE_CHECK_PERIOD = 256;
+
+    void acquire_pool()
+    {
+        lock_guard lock(m_manager->mutex());
+        m_pool = m_manager->get_pool(SLOT_SIZE);
+        m_pool_id = m_manager->get_pool_id(SLOT_SIZE);
+        m_pool_mutex = &m_manager->get_pool_mutex(SLOT_SIZE);
+    }
+
+    // requires locks of pools manager and of the pool to be held
+
     void add_mem_block(size_type size, const const_void_pointer& hint = nullptr)
     {
-        pointer mem = base_policy::allocate(size, pointer(nullptr), hint);
-        m_pool->add_mem_block(pointer_cast_traits<byte_pointer>::reinterpret_pcast(mem), size);
+        block_header header = {
+            details::upstream_allocate<upstream_unit, byte_pointer>(static_cast<const base_policy&>(*this),
+                                                                   upstream_size(size), hint),
+            upstream_size(size)
+        };
+        byte_pointer block = header.mem;
+        if (MOVES_BLOCKS) {
+            block += HEADER_SIZE;
+            if (ALIGNS_BLOCKS) {
+                std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(&*block);
+                block += (SLOT_ALIGN - (addr & (SLOT_ALIGN - 1))) & (SLOT_ALIGN - 1);
+            }
+            if (COLORS_BLOCKS) {
+                block += m_pool->next_color(pool_traits::CACHE_COLORS) * COLOR_STEP;
+            }
+            std::memcpy(&*block - sizeof(block_header), &header, sizeof(block_header));
+        }
+        m_manager->add_mem_block(m_pool, block, size);
+    }
+
+    // gives memory block of size objects back to base_policy, the block should be removed from the pool
+
+    void release_mem_block(const byte_pointer& block, size_type size)
+    {
+        block_header header = {block, upstream_size(size)};
+        if (MOVES_BLOCKS) {
+            std::memcpy(&header, &*block - sizeof(block_header), sizeof(block_header));
+        }
+        details::upstream_deallocate<upstream_unit>(static_cast<const base_policy&>(*this), header.mem, header.size);
+    }
+
+    // requires the lock of the pool to be held
+
+    size_type next_block_size() noexcept
+    {
+        size_type size = m_growth.next_block_size(m_block_size, m_pool->capacity(), m_pool->available());
+        assert(size > 0);
+        return size;
+    }
+
+    // checks the pool has at least n available objects, requires the lock of the pool to be held.
+    // Objects deallocated remotely are collected only when the pool is short of objects
+
+    bool is_pool_memory_available(size_type n = 1)
+    {
+        if (REMOTE_FREE && m_pool->available() < n) {
+            m_pool->collect_remote();
+        }
+        return m_pool->available() >= n;
+    }
+
+    // requires the lock of the pool to be held
+
+    size_type purge_pool(std::uint32_t now, std::uint32_t decay)
+    {
+        size_type purged = m_pool->purge(now, decay, [](const byte_pointer& mem, size_type size) {
+            return details::purge_pages(&*mem, size, pool_traits::PURGE_LAZY);
+        });
+        if (purged > 0) {
+            base_policy::notify_purge(purged);
+        }
+        return purged;
+    }
+
+    // the following methods take the required locks by themselves
+
+    // automatic trimming and purging after objects are returned to the pool
+
+    void maintain_pool()
+    {
+        auto_trim();
+        auto_purge();
+    }
+
+    // the clock is read once per PURGE_CHECK_PERIOD deallocations made through this copy of the policy
+
+    void auto_purge()
+    {
+        if (!AUTO_PURGE || --m_purge_countdown > 0) {
+            return;
+        }
+        m_purge_countdown = PURGE_CHECK_PERIOD;
+        std::uint32_t now = details::purge_clock();
+        lock_guard lock(*m_pool_mutex);
+        if (static_cast<std::uint32_t>(now - m_pool->last_purge()) >= pool_traits::PURGE_DECAY_MS) {
+            purge_pool(now, pool_traits::PURGE_DECAY_MS);
+        }
+    }
+
+    void auto_trim()
+    {
+        if (!AUTO_TRIM) {
+            return;
+        }
+        {
+            lock_guard lock(*m_pool_mutex);
+            // empty blocks are counted by the pool, so there are no futile attempts
+            // when free objects are scattered over all blocks
+            if (m_pool->empty_blocks() <= pool_traits::AUTO_TRIM_SPARE_BLOCKS
+                    || m_pool->available() * 100 <= pool_traits::AUTO_TRIM_PERCENT * m_pool->capacity()) {
+                return;
+            }
+        }
+        trim(pool_traits::AUTO_TRIM_SPARE_BLOCKS);
+    }
+
+    byte_pointer pool_allocate(const const_void_pointer& hint)
+    {
+        {
+            lock_guard lock(*m_pool_mutex);
+            if (is_pool_memory_available()) {
+                return m_pool->allocate(pool_traits::PREFETCH);
+            }
+        }
+        // the lock of the manager should be taken before the lock of the pool
+        lock_guard manager_lock(m_manager->mutex());
+        lock_guard pool_lock(*m_pool_mutex);
+        if (!is_pool_memory_available()) {
+            add_mem_block(next_block_size(), hint);
+        }
+        return m_pool->allocate(pool_traits::PREFETCH);
+    }
+
+    // objects of other pools and of base_policy deallocated remotely are put aside by collect_remote(),
+    // they are deallocated as by deallocate_batch. manager_locked tells the lock of the manager is held
+
+    void release_unowned(bool manager_locked = false)
+    {
+        if (!REMOTE_FREE || !m_pool->has_unowned()) {
+            return;
+        }
+        void* mem = m_pool->take_unowned();
+        while (mem) {
+            void* next = details::lockfree_stack::next(mem);
+            byte_pointer ptr = static_cast<byte_pointer>(mem);
+            if (!(manager_locked ? m_manager->deallocate(ptr) : pool_deallocate(ptr))) {
+                base_policy::deallocate(pointer_cast_traits<pointer>::reinterpret_pcast(ptr), 1);
+            }
+            mem = next;
+        }
+    }
+
+    // returns false if the pointer is not owned by any pool
+
+    bool pool_deallocate(const byte_pointer& ptr)
+    {
+        if (THREAD_SAFE) {
+            // own pool is checked first to not serialize deallocations on the lock of the manager
+            lock_guard lock(*m_pool_mutex);
+            if (m_pool->deallocate(ptr)) {
+                return true;
+            }
+        }
+        // pointer may be owned by the pool of this policy, by a pool of rebinded policy
+        // or it could be allocated by base_policy, all cases are resolved by single lookup
+        lock_guard lock(m_manager->mutex());
+        return m_manager->deallocate(ptr);
+    }
+
+    byte_pointer cached_allocate(const const_void_pointer& hint)
+    {
+        thread_cache_type* cache = thread_cache_type::instance();
+        if (!cache) {
+            return pool_allocate(hint);
+        }
+        auto& mag = cache->get_magazine(m_manager, SLOT_SIZE, m_pool_id, pool_traits::THREAD_CACHE_SIZE);
+        if (mag.empty()) {
+            {
+                lock_guard lock(*m_pool_mutex);
+                while (mag.size() < THREAD_CACHE_BATCH && is_pool_memory_available()) {
+                    mag.push(m_pool->allocate());
+                }
+            }
+            if (mag.empty()) {
+                return pool_allocate(hint);
+            }
+        }
+        return mag.pop();
+    }
+
+    // returns false if the thread cache is unavailable
+
+    bool cached_deallocate(const byte_pointer& ptr)
+    {
+        thread_cache_type* cache = thread_cache_type::instance();
+        if (!cache) {
+            return false;
+        }
+        auto& mag = cache->get_magazine(m_manager, SLOT_SIZE, m_pool_id, pool_traits::THREAD_CACHE_SIZE);
+        if (mag.size() == pool_traits::THREAD_CACHE_SIZE) {
+            // objects of other pools and of base_policy are deallocated as by deallocate_batch
+            size_type flushed = 0;
+            while (flushed < THREAD_CACHE_BATCH) {
+                byte_pointer other = nullptr;
+                {
+                    lock_guard lock(*m_pool_mutex);
+                    while (!other && flushed < THREAD_CACHE_BATCH) {
+                        byte_pointer mem = mag.pop();
+                        ++flushed;
+                        if (!m_pool->deallocate(mem)) {
+                            other = mem;
+                        }
+                    }
+                }
+                if (other && !pool_deallocate(other)) {
+                    base_policy::deallocate(pointer_cast_traits<pointer>::reinterpret_pcast(other), 1);
+                }
+            }
+            maintain_pool();
+        }
+        mag.push(ptr);
+        return true;
     }
 
     std::shared_ptr<pools_manager_type> m_manager;
     pool_type* m_pool;
+    std::uint64_t m_pool_id;
+    mutex_type* m_pool_mutex;
     size_type m_block_size;
+    growth_strategy m_growth;
+    size_type m_purge_countdown;
 };
 
-template <typename T, typename alloc_traits, typename base_policy>
-void swap(pool_allocation_policy<T, alloc_traits, base_policy>& alloc1,
-          pool_allocation_policy<T, alloc_traits, base_policy>& alloc2) noexcept
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const typename alloc_traits::size_type
+basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::DEFAULT_BLOCK_SIZE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const bool basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::REMOTE_FREE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const typename alloc_traits::size_type
+basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::SLOT_SIZE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const bool basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::THREAD_SAFE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const bool basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::THREAD_CACHING;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const bool basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::AUTO_TRIM;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const bool basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::AUTO_PURGE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const typename alloc_traits::size_type
+basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::THREAD_CACHE_BATCH;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const typename alloc_traits::size_type
+basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>::PURGE_CHECK_PERIOD;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+void swap(basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>& alloc1,
+          basic_pool_allocation_policy<T, alloc_traits, pool_traits, base_policy>& alloc2) noexcept
 {
     alloc1.swap(alloc2);
 }
 
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+using pool_allocation_policy = basic_pool_allocation_policy<T, alloc_traits, default_pool_traits, base_policy>;
+
+// pool which places every object on cache lines of its own
+
+struct cache_aligned_pool_traits: public default_pool_traits
+{
+    static const std::size_t SLOT_ALIGNMENT = CACHE_LINE_SIZE;
+};
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+using cache_aligned_pool_allocation_policy =
+    basic_pool_allocation_policy<T, alloc_traits, cache_aligned_pool_traits, base_policy>;
+
 } // namespace alloc_utility
 
 #endif // POOL_ALLOCATION_HPP
@@ -0,0 +1,106 @@
+#ifndef POOL_GROWTH_HPP
+#define POOL_GROWTH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+#include "macro.hpp"
+
+namespace alloc_utility
+{
+
+// growth strategies of pool allocation, they are selected by pool_traits::growth_strategy.
+// When the pool is exhausted the strategy is asked for the number of objects in the next memory block by
+//
+// size_type next_block_size(size_type block_size, size_type capacity, size_type available);
+//
+// where block_size is the block size of the policy (see basic_pool_allocation_policy::block_size),
+// capacity and available are the numbers of all and free objects in the pool.
+// The result should be at least 1. Each copy of the policy has its own copy of the strategy.
+
+// every block has block_size objects
+
+struct fixed_pool_growth
+{
+    template <typename size_type>
+    size_type next_block_size(size_type block_size, size_type capacity, size_type available) noexcept
+    {
+        ALLOC_UNUSED(capacity);
+        ALLOC_UNUSED(available);
+        return block_size;
+    }
+};
+
+// every block is as large as the whole pool (so the capacity doubles) but not larger than MAX_BLOCK_SIZE objects,
+// and not smaller than block_size objects.
+// Large pools need only logarithmic number of upstream allocations,
+// at the cost of up to a half of the capacity left unused after the last growth
+
+template <std::size_t MAX_BLOCK_SIZE = 65536>
+struct geometric_pool_growth
+{
+    static_assert(MAX_BLOCK_SIZE > 0, "MAX_BLOCK_SIZE should be positive");
+
+    template <typename size_type>
+    size_type next_block_size(size_type block_size, size_type capacity, size_type available) noexcept
+    {
+        ALLOC_UNUSED(available);
+        size_type max_size = static_cast<size_type>(MAX_BLOCK_SIZE);
+        return std::max(block_size, std::min(capacity, max_size));
+    }
+};
+
+// the block is sized to hold objects the pool is expected to allocate in the next HORIZON_MS milliseconds,
+// judging by the growth of allocated objects since the previous growth.
+// Blocks are at least block_size and at most MAX_BLOCK_SIZE objects,
+// so a steady trickle of allocations gets small blocks and a burst quickly gets large ones.
+// The clock is read only when the pool grows
+
+template <std::size_t HORIZON_MS = 10, std::size_t MAX_BLOCK_SIZE = 65536>
+class demand_pool_growth
+{
+    typedef std::chrono::steady_clock clock;
+
+public:
+
+    static_assert(MAX_BLOCK_SIZE > 0, "MAX_BLOCK_SIZE should be positive");
+
+    demand_pool_growth() noexcept:
+        m_last_growth()
+      , m_last_allocated(0)
+      , m_has_history(false)
+    {}
+
+    template <typename size_type>
+    size_type next_block_size(size_type block_size, size_type capacity, size_type available) noexcept
+    {
+        clock::time_point now = clock::now();
+        std::size_t allocated = capacity - available;
+        size_type size = block_size;
+        if (m_has_history && allocated > m_last_allocated) {
+            // elapsed time is rounded up, a burst within one millisecond is taken as lasting one millisecond
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_last_growth).count() + 1;
+            double expected = static_cast<double>(allocated - m_last_allocated) * HORIZON_MS / elapsed;
+            if (expected >= MAX_BLOCK_SIZE) {
+                size = static_cast<size_type>(MAX_BLOCK_SIZE);
+            } else {
+                size = static_cast<size_type>(expected);
+            }
+            size = std::max(block_size, size);
+        }
+        m_last_growth = now;
+        m_last_allocated = allocated;
+        m_has_history = true;
+        return size;
+    }
+
+private:
+    clock::time_point m_last_growth;
+    std::size_t m_last_allocated;
+    bool m_has_history;
+};
+
+} // namespace alloc_utility
+
+#endif // POOL_GROWTH_HPP
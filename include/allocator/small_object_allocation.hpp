@@ -0,0 +1,342 @@
+#ifndef SMALL_OBJECT_ALLOCATION_HPP
+#define SMALL_OBJECT_ALLOCATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "alloc_traits.hpp"
+#include "alloc_policies.hpp"
+#include "pointer_cast.hpp"
+#include "macro.hpp"
+#include "pool_allocation.hpp"
+#include "details/memory_pool.hpp"
+#include "details/upstream.hpp"
+
+namespace alloc_utility
+{
+
+// small_object_allocation_policy serves requests of any number of objects up to MAX_SMALL_SIZE bytes
+// (i.e. small arrays and string buffers) from pools of a fixed set of size classes:
+// the request is rounded up to 8 bytes, then to a multiple of 16 bytes up to 128 bytes
+// and to a multiple of 32 bytes up to 256 bytes, so at most 13 pools are used for all types.
+// Larger requests and types with extended alignment are passed to base_policy.
+// Copies and rebinded copies of the policy share the pools, the memory is returned to base_policy
+// when the last of them is destroyed. Memory of base_policy should be aligned as by operator new.
+// pool_traits customize pools as for basic_pool_allocation_policy,
+// thread caching and remote free are not supported.
+
+template <typename T, typename alloc_traits = allocation_traits<T>,
+          typename pool_traits = default_pool_traits,
+          typename base_policy = default_allocation_policy<T, alloc_traits>>
+class small_object_allocation_policy: public base_policy
+{
+    typedef typename std::pointer_traits<typename alloc_traits::pointer>::template rebind<std::uint8_t> byte_pointer;
+    typedef typename pool_traits::chunk_index_type chunk_index_type;
+    typedef typename pool_traits::mutex_type mutex_type;
+    typedef typename pool_traits::growth_strategy growth_strategy;
+    typedef std::lock_guard<mutex_type> lock_guard;
+    typedef details::memory_pool<byte_pointer, typename alloc_traits::size_type, chunk_index_type> pool_type;
+    typedef details::pools_manager<byte_pointer, typename alloc_traits::size_type,
+                                   chunk_index_type, mutex_type> pools_manager_type;
+
+    static const std::size_t SIZE_CLASSES_NUM = 13;
+
+    // memory blocks are shared by rebinded copies, so they are requested in units of the smallest size class
+    typedef details::upstream_unit<8> upstream_unit;
+
+public:
+
+    DECLARE_ALLOC_TRAITS(T, alloc_traits)
+    DECLARE_REBIND_ALLOC(small_object_allocation_policy, T, alloc_traits, pool_traits, base_policy)
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    typedef pool_traits pool_traits_type;
+
+    static const size_type DEFAULT_BLOCK_SIZE = std::numeric_limits<std::uint8_t>::max();
+
+    // requests of larger size in bytes are passed to base_policy
+    static const size_type MAX_SMALL_SIZE = 256;
+
+    // objects of type T are served from pools unless their alignment can't be guaranteed by size classes
+    static const bool IS_POOLED = alignof(T) <= alignof(std::max_align_t) && alignof(T) <= 16;
+
+    static const bool THREAD_SAFE = pools_manager_type::THREAD_SAFE;
+
+    static_assert(pool_traits::THREAD_CACHE_SIZE == 0, "Thread caching isn't supported by small object allocation");
+    static_assert(!pool_traits::REMOTE_FREE, "Remote free isn't supported by small object allocation");
+    static_assert(pool_traits::SLOT_ALIGNMENT <= 1, "Slot alignment isn't supported by small object allocation");
+    static_assert(pool_traits::CACHE_COLORS <= 1, "Cache coloring isn't supported by small object allocation");
+    static_assert(MAX_SMALL_SIZE <= pools_manager_type::MAX_INDEXED_OBJ_SIZE, "Size classes should be indexed");
+
+    // block_size is the number of objects in memory blocks of each size class passed to the growth strategy
+
+    explicit small_object_allocation_policy(size_type block_size = DEFAULT_BLOCK_SIZE):
+        m_manager(std::make_shared<pools_manager_type>())
+      , m_block_size(block_size)
+    {
+        acquire_pools();
+    }
+
+    small_object_allocation_policy(const small_object_allocation_policy& other) noexcept:
+        base_policy(other)
+      , m_manager(other.m_manager)
+      , m_block_size(other.m_block_size)
+    {
+        copy_pools(other);
+    }
+
+    small_object_allocation_policy(small_object_allocation_policy&& other) noexcept:
+        base_policy(std::move(other))
+      , m_manager(std::move(other.m_manager))
+      , m_block_size(other.m_block_size)
+    {
+        for (std::size_t i = 0; i < SIZE_CLASSES_NUM; ++i) {
+            m_pools[i] = other.m_pools[i];
+            m_pool_mutexes[i] = other.m_pool_mutexes[i];
+            m_growth[i] = other.m_growth[i];
+        }
+    }
+
+    template <typename U>
+    small_object_allocation_policy(const rebind<U>& other) noexcept:
+        base_policy(other)
+      , m_manager(other.m_manager)
+      , m_block_size(other.m_block_size)
+    {
+        copy_pools(other);
+    }
+
+    ~small_object_allocation_policy()
+    {
+        if (!m_manager) {
+            return;
+        }
+        lock_guard lock(m_manager->mutex());
+        for (std::size_t i = 0; i < SIZE_CLASSES_NUM; ++i) {
+            size_type obj_size = class_size(i);
+            if (m_manager->release_pool(obj_size) > 0) {
+                continue;
+            }
+            typename pool_type::memory_blocks_range mb_range = m_pools[i]->get_mem_blocks();
+            for (auto it = mb_range.begin(); it != mb_range.end(); ++it) {
+                details::upstream_deallocate<upstream_unit>(static_cast<const base_policy&>(*this),
+                                                            it->get_memory_ptr(), upstream_size(it->size(), obj_size));
+            }
+            m_manager->erase_pool(obj_size);
+        }
+    }
+
+    small_object_allocation_policy& operator=(small_object_allocation_policy other) noexcept
+    {
+        other.swap(*this);
+        return *this;
+    }
+
+    void swap(small_object_allocation_policy& other) noexcept
+    {
+        using std::swap;
+        swap(static_cast<base_policy&>(*this), static_cast<base_policy&>(other));
+        swap(m_manager, other.m_manager);
+        swap(m_block_size, other.m_block_size);
+        for (std::size_t i = 0; i < SIZE_CLASSES_NUM; ++i) {
+            swap(m_pools[i], other.m_pools[i]);
+            swap(m_pool_mutexes[i], other.m_pool_mutexes[i]);
+            swap(m_growth[i], other.m_growth[i]);
+        }
+    }
+
+    // returns the size of memory occupied by n objects,
+    // it is 0 if they are not served from pools
+
+    static constexpr size_type slot_size(size_type n) noexcept
+    {
+        return is_small(n) ? class_size(class_index(n * sizeof(T))) : 0;
+    }
+
+    size_type block_size() const noexcept
+    {
+        return m_block_size;
+    }
+
+    void set_block_size(size_type block_size) noexcept
+    {
+        assert(block_size > 0);
+        m_block_size = block_size;
+    }
+
+    // returns the number of objects of the size class of n objects of type T the pool has memory for
+    // (0 if they are not served from pools)
+
+    size_type capacity(size_type n = 1) const noexcept
+    {
+        if (!is_small(n)) {
+            return 0;
+        }
+        std::size_t idx = class_index(n * sizeof(T));
+        lock_guard lock(*m_pool_mutexes[idx]);
+        return m_pools[idx]->capacity();
+    }
+
+    pointer allocate(size_type n, const pointer& ptr, const const_void_pointer& hint = nullptr)
+    {
+        if (ptr) {
+            return ptr;
+        }
+        if (!is_small(n)) {
+            return base_policy::allocate(n, ptr, hint);
+        }
+        std::size_t idx = class_index(n * sizeof(T));
+        {
+            lock_guard lock(*m_pool_mutexes[idx]);
+            if (m_pools[idx]->available() > 0) {
+                return pointer_cast_traits<pointer>::reinterpret_pcast(m_pools[idx]->allocate(pool_traits::PREFETCH));
+            }
+        }
+        // the lock of the manager should be taken before the lock of the pool
+        lock_guard manager_lock(m_manager->mutex());
+        lock_guard pool_lock(*m_pool_mutexes[idx]);
+        if (m_pools[idx]->available() == 0) {
+            add_mem_block(idx, hint);
+        }
+        return pointer_cast_traits<pointer>::reinterpret_pcast(m_pools[idx]->allocate(pool_traits::PREFETCH));
+    }
+
+    void deallocate(const pointer& ptr, size_type n)
+    {
+        if (!ptr || !is_small(n)) {
+            base_policy::deallocate(ptr, n);
+            return;
+        }
+        byte_pointer byte_ptr = pointer_cast_traits<byte_pointer>::reinterpret_pcast(ptr);
+        std::size_t idx = class_index(n * sizeof(T));
+        {
+            lock_guard lock(*m_pool_mutexes[idx]);
+            if (m_pools[idx]->deallocate(byte_ptr)) {
+                return;
+            }
+        }
+        // n may differ from the allocated number of objects within the same size class only,
+        // so the pointer is looked up among all pools as a last resort
+        {
+            lock_guard lock(m_manager->mutex());
+            if (m_manager->deallocate(byte_ptr)) {
+                return;
+            }
+        }
+        base_policy::deallocate(ptr, n);
+    }
+
+    bool operator==(const small_object_allocation_policy& other) const noexcept
+    {
+        return (m_manager == other.m_manager);
+    }
+
+    bool operator!=(const small_object_allocation_policy& other) const noexcept
+    {
+        return !operator==(other);
+    }
+
+    template <typename, typename, typename, typename>
+    friend class small_object_allocation_policy;
+
+private:
+
+    static constexpr bool is_small(size_type n) noexcept
+    {
+        return IS_POOLED && n > 0 && n <= MAX_SMALL_SIZE / sizeof(T);
+    }
+
+    // size classes: 8, 16, 32, ..., 128, 160, 192, 224, 256
+
+    static constexpr std::size_t class_index(size_type size) noexcept
+    {
+        return size <= 8 ? 0 : (size <= 128 ? (size + 15) / 16 : 8 + (size - 128 + 31) / 32);
+    }
+
+    static constexpr size_type class_size(std::size_t idx) noexcept
+    {
+        return idx == 0 ? 8 : (idx <= 8 ? idx * 16 : 128 + (idx - 8) * 32);
+    }
+
+    // number of bytes requested from base_policy for a memory block of size objects of obj_size
+
+    static size_type upstream_size(size_type size, size_type obj_size) noexcept
+    {
+        return size * obj_size;
+    }
+
+    void acquire_pools()
+    {
+        lock_guard lock(m_manager->mutex());
+        for (std::size_t i = 0; i < SIZE_CLASSES_NUM; ++i) {
+            m_pools[i] = m_manager->get_pool(class_size(i));
+            m_pool_mutexes[i] = &m_manager->get_pool_mutex(class_size(i));
+        }
+    }
+
+    // other holds references to the pools, so they may be taken without the lock since all of them are indexed
+
+    template <typename policy>
+    void copy_pools(const policy& other) noexcept
+    {
+        for (std::size_t i = 0; i < SIZE_CLASSES_NUM; ++i) {
+            m_pools[i] = m_manager->get_pool(class_size(i), std::nothrow);
+            m_pool_mutexes[i] = other.m_pool_mutexes[i];
+            m_growth[i] = other.m_growth[i];
+        }
+    }
+
+    // requires locks of pools manager and of the pool to be held
+
+    void add_mem_block(std::size_t idx, const const_void_pointer& hint)
+    {
+        pool_type* pool = m_pools[idx];
+        size_type size = m_growth[idx].next_block_size(m_block_size, pool->capacity(), pool->available());
+        byte_pointer mem = details::upstream_allocate<upstream_unit, byte_pointer>(
+            static_cast<const base_policy&>(*this), upstream_size(size, pool->obj_size()), hint);
+        m_manager->add_mem_block(pool, mem, size);
+    }
+
+    std::shared_ptr<pools_manager_type> m_manager;
+    pool_type* m_pools[SIZE_CLASSES_NUM];
+    mutex_type* m_pool_mutexes[SIZE_CLASSES_NUM];
+    growth_strategy m_growth[SIZE_CLASSES_NUM];
+    size_type m_block_size;
+};
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const std::size_t small_object_allocation_policy<T, alloc_traits, pool_traits, base_policy>::SIZE_CLASSES_NUM;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const typename alloc_traits::size_type
+small_object_allocation_policy<T, alloc_traits, pool_traits, base_policy>::DEFAULT_BLOCK_SIZE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const typename alloc_traits::size_type
+small_object_allocation_policy<T, alloc_traits, pool_traits, base_policy>::MAX_SMALL_SIZE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const bool small_object_allocation_policy<T, alloc_traits, pool_traits, base_policy>::IS_POOLED;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+const bool small_object_allocation_policy<T, alloc_traits, pool_traits, base_policy>::THREAD_SAFE;
+
+template <typename T, typename alloc_traits, typename pool_traits, typename base_policy>
+void swap(small_object_allocation_policy<T, alloc_traits, pool_traits, base_policy>& alloc1,
+          small_object_allocation_policy<T, alloc_traits, pool_traits, base_policy>& alloc2) noexcept
+{
+    alloc1.swap(alloc2);
+}
+
+} // namespace alloc_utility
+
+#endif // SMALL_OBJECT_ALLOCATION_HPP
@@ -20,6 +20,8 @@ public:
         m_allocs_count(0)
       , m_deallocs_count(0)
       , m_mem_used(0)
+      , m_purges_count(0)
+      , m_purged_mem(0)
     {}
 
     size_type allocs_count() const noexcept
@@ -42,6 +44,18 @@ public:
         return m_mem_used;
     }
 
+    // number of purges and the total size of memory given back to the system by them
+
+    size_type purges_count() const noexcept
+    {
+        return m_purges_count;
+    }
+
+    size_type purged_mem() const noexcept
+    {
+        return m_purged_mem;
+    }
+
     void register_alloc(const const_void_pointer& ptr, size_type n) noexcept
     {
         ALLOC_UNUSED(ptr);
@@ -56,10 +70,18 @@ public:
         m_mem_used -= n;
     }
 
+    void register_purge(size_type n) noexcept
+    {
+        ++m_purges_count;
+        m_purged_mem += n;
+    }
+
 private:
     size_type m_allocs_count;
     size_type m_deallocs_count;
     size_type m_mem_used;
+    size_type m_purges_count;
+    size_type m_purged_mem;
 };
 
 template <typename T, typename alloc_traits = allocation_traits<T>,
@@ -102,6 +124,14 @@ public:
         base_policy::deallocate(ptr, n);
     }
 
+    void notify_purge(size_type size) noexcept
+    {
+        if (m_stat) {
+            m_stat->register_purge(size);
+        }
+        base_policy::notify_purge(size);
+    }
+
     statistic* get_statistic() const noexcept
     {
         return m_stat;
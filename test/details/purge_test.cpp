@@ -0,0 +1,43 @@
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "details/purge.hpp"
+
+using namespace alloc_utility::details;
+
+TEST(purge_test, test_purge_pages)
+{
+    const size_t PAGES_NUM = 64;
+    const size_t page = page_size();
+
+    std::vector<std::uint8_t> mem(PAGES_NUM * page, 42);
+    // range doesn't start at page boundary, so its first and last pages are not purged
+    std::uint8_t* first = mem.data() + page / 2;
+    size_t size = (PAGES_NUM - 1) * page;
+    size_t purged = purge_pages(first, size);
+
+#ifdef ALLOC_HAS_PURGE_PAGES
+    EXPECT_GE(purged, (PAGES_NUM - 3) * page);
+    EXPECT_LT(purged, size);
+    EXPECT_EQ(0u, purged % page);
+    EXPECT_EQ(42, first[0]);
+    EXPECT_EQ(42, first[size - 1]);
+    size_t zeros = 0;
+    for (size_t i = 0; i < size; ++i) {
+        zeros += (first[i] == 0) ? 1 : 0;
+    }
+    EXPECT_EQ(purged, zeros);
+#else
+    EXPECT_EQ(0u, purged);
+#endif
+
+    EXPECT_EQ(0u, purge_pages(first, page / 2));
+
+    // purged memory stays usable
+    for (auto& byte: mem) {
+        byte = 42;
+    }
+    EXPECT_EQ(42, mem[PAGES_NUM * page / 2]);
+}
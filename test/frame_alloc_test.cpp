@@ -0,0 +1,180 @@
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "allocator.hpp"
+#include "alloc_policies.hpp"
+#include "frame_allocation.hpp"
+#include "statistic_policy.hpp"
+
+using namespace alloc_utility;
+
+class frame_allocation_policy_test: public ::testing::Test
+{
+public:
+
+    typedef frame_allocation_policy<int, allocation_traits<int>,
+                                        default_allocation_policy<int, allocation_traits<int>,
+                                            statistic_policy<int>
+                                        >
+                                   > int_allocator;
+
+    typedef typename int_allocator::rebind<char> char_allocator;
+    typedef typename int_allocator::statistic_type statistic;
+
+    static const size_t FRAME_SIZE = 64;
+
+    frame_allocation_policy_test():
+        alloc(FRAME_SIZE)
+    {
+        alloc.set_statistic(&stat);
+    }
+
+    statistic stat;
+    int_allocator alloc;
+};
+
+TEST_F(frame_allocation_policy_test, test_allocate)
+{
+    EXPECT_EQ(2u, alloc.frames_count());
+    EXPECT_EQ((size_t)FRAME_SIZE, alloc.frame_size());
+    EXPECT_EQ(0, stat.allocs_count());
+
+    int* ptr1 = alloc.allocate(4, nullptr);
+    int* ptr2 = alloc.allocate(4, nullptr);
+    EXPECT_EQ(ptr1 + 4, ptr2);
+    EXPECT_EQ(1, stat.allocs_count());
+    EXPECT_EQ(8 * sizeof(int), alloc.frame_usage());
+    ptr2[3] = 42;
+
+    // deallocation does nothing
+    alloc.deallocate(ptr1, 4);
+    EXPECT_EQ(ptr2 + 4, alloc.allocate(1, nullptr));
+    EXPECT_EQ(0, stat.deallocs_count());
+
+    int* ptr3 = alloc.allocate(1, nullptr);
+    EXPECT_EQ(ptr3, alloc.allocate(1, ptr3));
+}
+
+TEST_F(frame_allocation_policy_test, test_next_frame)
+{
+    int* ptr1 = alloc.allocate(4, nullptr);
+    alloc.next_frame();
+    EXPECT_EQ(1u, alloc.frame_number());
+    EXPECT_EQ(0u, alloc.frame_usage());
+    EXPECT_EQ(4 * sizeof(int), alloc.peak_frame_usage());
+
+    // the second frame has its own buffer, objects of the previous frame are still valid
+    int* ptr2 = alloc.allocate(2, nullptr);
+    EXPECT_EQ(2, stat.allocs_count());
+    EXPECT_TRUE(ptr2 < ptr1 || ptr2 >= ptr1 + FRAME_SIZE / sizeof(int));
+
+    // the first frame is reused from the beginning
+    alloc.next_frame();
+    EXPECT_EQ(ptr1, alloc.allocate(1, nullptr));
+    EXPECT_EQ(2, stat.allocs_count());
+    EXPECT_EQ(0, stat.deallocs_count());
+    EXPECT_EQ(4 * sizeof(int), alloc.peak_frame_usage());
+}
+
+TEST_F(frame_allocation_policy_test, test_overflow)
+{
+    int* ptr1 = alloc.allocate(FRAME_SIZE / sizeof(int), nullptr);
+    int* ptr2 = alloc.allocate(2, nullptr);
+    int* ptr3 = alloc.allocate(100, nullptr);
+    ptr2[1] = ptr3[99] = 42;
+    EXPECT_NE(nullptr, ptr1);
+    EXPECT_EQ(2u, alloc.overflows_count());
+    EXPECT_EQ(3, stat.allocs_count());
+    EXPECT_EQ(FRAME_SIZE + 102 * sizeof(int), alloc.frame_usage());
+
+    // memory passed to base_policy is freed when the frame is reused
+    alloc.next_frame();
+    EXPECT_EQ(0, stat.deallocs_count());
+    alloc.next_frame();
+    EXPECT_EQ(2, stat.deallocs_count());
+    EXPECT_EQ((size_t)FRAME_SIZE, stat.mem_used());
+    EXPECT_EQ(FRAME_SIZE + 102 * sizeof(int), alloc.peak_frame_usage());
+}
+
+TEST_F(frame_allocation_policy_test, test_copy)
+{
+    char_allocator char_alloc(alloc);
+    EXPECT_TRUE(int_allocator(char_alloc) == alloc);
+    EXPECT_TRUE(alloc != int_allocator());
+
+    char* chars = char_alloc.allocate(3, nullptr);
+    int* ints = alloc.allocate(1, nullptr);
+    EXPECT_EQ((int*)(chars + sizeof(int)), ints);
+    char_alloc.next_frame();
+    EXPECT_EQ(1u, alloc.frame_number());
+    EXPECT_EQ(2 * sizeof(int), alloc.peak_frame_usage());
+}
+
+TEST_F(frame_allocation_policy_test, test_destroy)
+{
+    if (true) {
+        int_allocator local_alloc(FRAME_SIZE, 3);
+        local_alloc.set_statistic(&stat);
+        int_allocator copy = local_alloc;
+        for (int i = 0; i < 3; ++i) {
+            local_alloc.allocate(1, nullptr);
+            local_alloc.allocate(100, nullptr);
+            local_alloc.next_frame();
+        }
+        EXPECT_EQ(6, stat.allocs_count());
+        EXPECT_EQ(1, stat.deallocs_count());
+    }
+    EXPECT_EQ(6, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST_F(frame_allocation_policy_test, test_rebind_release)
+{
+    struct alignas(64) line
+    {
+        char data[64];
+    };
+
+    if (true) {
+        int_allocator local_alloc(FRAME_SIZE);
+        local_alloc.set_statistic(&stat);
+        if (true) {
+            // buffer and overflow memory allocated by copies of other types are released by the int copy
+            char_allocator char_alloc(local_alloc);
+            char_alloc.allocate(7, nullptr);
+            char_alloc.allocate(FRAME_SIZE + 7, nullptr);
+            int_allocator::rebind<line> line_alloc(local_alloc);
+            line* l = line_alloc.allocate(2, nullptr);
+            EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(l) % alignof(line));
+            EXPECT_EQ(2u, local_alloc.overflows_count());
+        }
+        local_alloc.next_frame();
+        local_alloc.next_frame();
+        EXPECT_EQ(3, stat.allocs_count());
+        EXPECT_EQ(2, stat.deallocs_count());
+        EXPECT_EQ((size_t)FRAME_SIZE, stat.mem_used());
+    }
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST(frame_allocator_test, test_vector)
+{
+    typedef allocator<int, allocation_traits<int>,
+                        frame_allocation_policy<int>,
+                        default_allocation_policy<int>
+                     > int_allocator;
+
+    int_allocator alloc;
+    for (int frame = 0; frame < 10; ++frame) {
+        std::vector<int, int_allocator> vec(alloc);
+        for (int i = 0; i < 1000; ++i) {
+            vec.push_back(i + frame);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            EXPECT_EQ(i + frame, vec[i]);
+        }
+        alloc.next_frame();
+    }
+}
@@ -1,14 +1,38 @@
+#include <algorithm>
 #include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "allocator.hpp"
+#include "details/concurrent_linear_storage.hpp"
+#include "details/linear_arena.hpp"
 #include "details/linear_storage.hpp"
 #include "linear_allocation.hpp"
+#include "monotonic_allocation.hpp"
 #include "statistic_policy.hpp"
 
 using namespace alloc_utility;
+using alloc_utility::details::concurrent_linear_storage;
+using alloc_utility::details::linear_arena;
 using alloc_utility::details::linear_storage;
 
+namespace
+{
+
+// storage of allocate_storage isn't owned by the policy,
+// tests give it back to default_allocation_policy which allocated it
+
+template <typename policy>
+void free_storage(const policy& alloc)
+{
+    default_allocation_policy<typename policy::value_type>().deallocate(alloc.get_storage(), alloc.storage_size());
+}
+
+}
+
 class linear_storage_test: public ::testing::Test
 {
 public:
@@ -22,7 +46,7 @@ public:
         storage.set_storage(mem, STORAGE_SIZE);
     }
 
-    byte mem[STORAGE_SIZE];
+    alignas(16) byte mem[STORAGE_SIZE];
     storage_type storage;
 };
 
@@ -73,6 +97,166 @@ TEST_F(linear_storage_test, test_allocate)
     *ptr2 = 42;
 }
 
+TEST_F(linear_storage_test, test_allocate_aligned)
+{
+    byte* ptr1 = storage.allocate(3, 8);
+    EXPECT_EQ(mem, ptr1);
+    byte* ptr2 = storage.allocate(1, 8);
+    EXPECT_EQ(mem + 8, ptr2);
+    // already aligned memory isn't padded
+    byte* ptr3 = storage.allocate(4, 1);
+    EXPECT_EQ(mem + 9, ptr3);
+    byte* ptr4 = storage.allocate(1, 16);
+    EXPECT_EQ(mem + 16, ptr4);
+
+    // padding counts against available memory
+    EXPECT_TRUE(storage.is_memory_available(STORAGE_SIZE - 17, 1));
+    EXPECT_TRUE(storage.is_memory_available(STORAGE_SIZE - 32, 16));
+    EXPECT_FALSE(storage.is_memory_available(STORAGE_SIZE - 31, 16));
+
+    // alignment is relative to the address rather than to the storage
+    storage.set_storage(mem + 1, STORAGE_SIZE - 1);
+    EXPECT_EQ(mem + 16, storage.allocate(1, 16));
+}
+
+TEST_F(linear_storage_test, test_rewind)
+{
+    storage.allocate(8);
+    size_t marker = storage.get_marker();
+    EXPECT_EQ(8u, marker);
+    storage.allocate(16);
+    storage.allocate(4);
+    storage.rewind(marker);
+    EXPECT_EQ(marker, storage.get_marker());
+    EXPECT_EQ(mem + 8, storage.allocate(4));
+    EXPECT_TRUE(storage.is_memory_available(STORAGE_SIZE - 12));
+
+    storage.rewind(0);
+    EXPECT_EQ(mem, storage.allocate(1));
+}
+
+TEST_F(linear_storage_test, test_free_last)
+{
+    byte* ptr1 = storage.allocate(8);
+    byte* ptr2 = storage.allocate(8);
+    EXPECT_FALSE(storage.free_last(ptr1, 8));
+    EXPECT_TRUE(storage.is_last(ptr2, 8));
+    EXPECT_TRUE(storage.free_last(ptr2, 8));
+    EXPECT_EQ(8u, storage.get_marker());
+
+    EXPECT_TRUE(storage.try_resize(ptr1, 8, STORAGE_SIZE));
+    EXPECT_FALSE(storage.is_memory_available(1));
+    EXPECT_FALSE(storage.try_resize(ptr1, STORAGE_SIZE, STORAGE_SIZE + 1));
+    EXPECT_TRUE(storage.try_resize(ptr1, STORAGE_SIZE, 4));
+    EXPECT_EQ(mem + 4, storage.allocate(1));
+}
+
+TEST_F(linear_storage_test, test_purge)
+{
+    std::vector<std::pair<byte*, size_t>> ranges;
+    auto purge = [&ranges](byte* mem, size_t size) {
+        ranges.emplace_back(mem, size);
+        return size;
+    };
+
+    // contents of new storage is unknown, so all its free memory is purged
+    EXPECT_EQ((size_t)STORAGE_SIZE, storage.purge(10, 0, purge));
+    EXPECT_EQ(0u, storage.purge(10, 0, purge));
+
+    storage.allocate(STORAGE_SIZE / 2);
+    EXPECT_EQ(0u, storage.purge(20, 0, purge));
+
+    // the tail used before the reset is purged after it stays idle for decay
+    storage.set_storage(mem, STORAGE_SIZE);
+    storage.allocate(STORAGE_SIZE / 8);
+    EXPECT_EQ(0u, storage.purge(30, 5, purge));
+    storage.allocate(STORAGE_SIZE / 8);
+    EXPECT_EQ(0u, storage.purge(35, 5, purge));
+    EXPECT_EQ((size_t)STORAGE_SIZE / 4, storage.purge(40, 5, purge));
+
+    ASSERT_EQ(2u, ranges.size());
+    EXPECT_EQ(mem, ranges[0].first);
+    EXPECT_EQ(mem + STORAGE_SIZE / 4, ranges[1].first);
+    EXPECT_EQ((size_t)STORAGE_SIZE / 4, ranges[1].second);
+}
+
+class concurrent_linear_storage_test: public ::testing::Test
+{
+public:
+    typedef std::uint8_t byte;
+    typedef concurrent_linear_storage<byte*, size_t> storage_type;
+
+    static const size_t STORAGE_SIZE = 4096;
+
+    concurrent_linear_storage_test()
+    {
+        storage.set_storage(mem, STORAGE_SIZE);
+    }
+
+    alignas(16) byte mem[STORAGE_SIZE];
+    storage_type storage;
+};
+
+TEST_F(concurrent_linear_storage_test, test_allocate)
+{
+    EXPECT_EQ(mem, storage.try_allocate(3));
+    EXPECT_EQ(mem + 8, storage.try_allocate(8, 8));
+    EXPECT_EQ(nullptr, storage.try_allocate(STORAGE_SIZE));
+    EXPECT_EQ(16u, storage.get_marker());
+    EXPECT_TRUE(storage.is_memory_available(STORAGE_SIZE - 16));
+    EXPECT_FALSE(storage.is_memory_available(STORAGE_SIZE - 15));
+
+    byte* ptr = storage.try_allocate(8);
+    EXPECT_FALSE(storage.free_last(mem + 8, 8));
+    EXPECT_TRUE(storage.try_resize(ptr, 8, 16));
+    EXPECT_TRUE(storage.free_last(ptr, 16));
+    EXPECT_EQ(ptr, storage.try_allocate(1));
+
+    storage.rewind(8);
+    EXPECT_EQ(mem + 8, storage.allocate(1));
+}
+
+TEST_F(concurrent_linear_storage_test, test_threads)
+{
+    const size_t THREADS_NUM = 4;
+    const size_t ALLOC_SIZE = 8;
+    const size_t ALLOCS_NUM = STORAGE_SIZE / ALLOC_SIZE;
+
+    // threads request twice as much memory as the storage has
+    std::vector<std::vector<byte*>> ptrs(THREADS_NUM);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREADS_NUM; ++i) {
+        threads.emplace_back([this, i, &ptrs] {
+            for (size_t j = 0; j < 2 * ALLOCS_NUM / THREADS_NUM; ++j) {
+                byte* ptr = storage.try_allocate(ALLOC_SIZE, ALLOC_SIZE);
+                if (ptr) {
+                    std::fill(ptr, ptr + ALLOC_SIZE, static_cast<byte>(i));
+                    ptrs[i].push_back(ptr);
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    std::vector<byte*> all_ptrs;
+    for (size_t i = 0; i < THREADS_NUM; ++i) {
+        for (byte* ptr: ptrs[i]) {
+            EXPECT_EQ(static_cast<byte>(i), ptr[0]);
+            EXPECT_EQ(static_cast<byte>(i), ptr[ALLOC_SIZE - 1]);
+            all_ptrs.push_back(ptr);
+        }
+    }
+    // every slot of the storage is allocated exactly once
+    std::sort(all_ptrs.begin(), all_ptrs.end());
+    ASSERT_EQ(ALLOCS_NUM, all_ptrs.size());
+    for (size_t i = 0; i < ALLOCS_NUM; ++i) {
+        EXPECT_EQ(mem + i * ALLOC_SIZE, all_ptrs[i]);
+    }
+    EXPECT_FALSE(storage.is_memory_available(1));
+}
+
 class linear_allocation_policy_test: public ::testing::Test
 {
 public:
@@ -101,7 +285,7 @@ public:
     }
 
     statistic stat;
-    byte mem[STORAGE_SIZE * sizeof(int)];
+    alignas(16) byte mem[STORAGE_SIZE * sizeof(int)];
     int_allocator alloc;
 };
 
@@ -165,18 +349,59 @@ TEST_F(linear_allocation_policy_test, test_allocate)
 TEST_F(linear_allocation_policy_test, test_deallocate)
 {
     int* ptr1 = alloc.allocate(STORAGE_SIZE, nullptr);
+    int* ptr2 = alloc.allocate(1, nullptr);
     alloc.deallocate(ptr1, STORAGE_SIZE);
     EXPECT_EQ(0, stat.deallocs_count());
-    EXPECT_EQ(0, stat.allocated_blocks_count());
-    EXPECT_EQ(0, stat.mem_used());
+    EXPECT_EQ(1, stat.allocated_blocks_count());
 
-    int* ptr2 = alloc.allocate(1, nullptr);
     alloc.deallocate(ptr2, 1);
     EXPECT_EQ(1, stat.deallocs_count());
     EXPECT_EQ(0, stat.allocated_blocks_count());
     EXPECT_EQ(0, stat.mem_used());
 }
 
+TEST_F(linear_allocation_policy_test, test_deallocate_last)
+{
+    // base_policy doesn't free memory, so deallocations from the fixture storage never reach operator delete
+    typedef linear_allocation_policy<int, allocation_traits<int>, statistic_policy<int>> storage_allocator;
+
+    storage_allocator storage_alloc;
+    storage_alloc.set_storage((int*)mem, STORAGE_SIZE);
+    storage_alloc.set_statistic(&stat);
+    int* ptr1 = storage_alloc.allocate(10, nullptr);
+    int* ptr2 = storage_alloc.allocate(10, nullptr);
+
+    // only the last allocation is given back to the storage
+    storage_alloc.deallocate(ptr1, 10);
+    EXPECT_EQ(ptr2 + 10, storage_alloc.allocate(1, nullptr));
+    storage_alloc.deallocate(ptr2 + 10, 1);
+    storage_alloc.deallocate(ptr2, 10);
+    EXPECT_EQ(ptr2, storage_alloc.allocate(STORAGE_SIZE - 10, nullptr));
+    EXPECT_EQ(0, stat.allocs_count());
+    EXPECT_EQ(0, stat.deallocs_count());
+}
+
+TEST_F(linear_allocation_policy_test, test_try_resize)
+{
+    int* ptr1 = alloc.allocate(10, nullptr);
+    int* ptr2 = alloc.allocate(10, nullptr);
+    EXPECT_FALSE(alloc.try_resize(ptr1, 10, 20));
+
+    EXPECT_TRUE(alloc.expand(ptr2, 10, 20));
+    EXPECT_EQ(ptr2 + 20, alloc.allocate(1, nullptr));
+    ptr2 = alloc.allocate(10, nullptr);
+    EXPECT_TRUE(alloc.try_resize(ptr2, 10, 5));
+    EXPECT_EQ(ptr2 + 5, alloc.allocate(1, nullptr));
+
+    // the storage is exhausted
+    int* ptr3 = alloc.allocate(1, nullptr);
+    size_t available = STORAGE_SIZE - (ptr3 + 1 - (int*)mem);
+    EXPECT_FALSE(alloc.expand(ptr3, 1, available + 2));
+    EXPECT_TRUE(alloc.expand(ptr3, 1, available + 1));
+    EXPECT_FALSE(alloc.is_memory_available(1));
+    EXPECT_FALSE(alloc.try_resize(ptr3 + 1, 0, 1));
+}
+
 TEST_F(linear_allocation_policy_test, test_comparison)
 {
     int_allocator other;
@@ -200,3 +425,532 @@ TEST_F(linear_allocation_policy_test, test_copy_construct)
     EXPECT_FALSE(alloc_copy.is_memory_available(1));
     EXPECT_FALSE(char_alloc.is_memory_available(1));
 }
+
+TEST_F(linear_allocation_policy_test, test_alignment)
+{
+    EXPECT_EQ(alignof(int), alloc.alignment());
+
+    // rebinded copies share the storage, so each allocation is aligned by its own type
+    char_allocator char_alloc(alloc);
+    typedef typename int_allocator::rebind<double> double_allocator;
+    double_allocator double_alloc(alloc);
+
+    char* chars = char_alloc.allocate(3, nullptr);
+    EXPECT_EQ((char*)mem, chars);
+    double* doubles = double_alloc.allocate(2, nullptr);
+    EXPECT_EQ((double*)(mem + alignof(double)), doubles);
+    doubles[1] = 42;
+    int* ints = alloc.allocate(1, nullptr);
+    EXPECT_EQ((int*)(mem + alignof(double) + 2 * sizeof(double)), ints);
+
+    // explicit alignment is inherited by rebinded copies
+    alloc.set_alignment(64);
+    EXPECT_EQ(64u, alloc.alignment());
+    EXPECT_EQ(64u, char_allocator(alloc).alignment());
+    EXPECT_EQ(1u, char_alloc.alignment());
+    int* aligned = alloc.allocate(8, nullptr);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(aligned) % 64);
+    EXPECT_LT((byte*)aligned, (byte*)(ints + 1) + 64);
+
+    int_allocator page_alloc(details::page_size());
+    page_alloc.allocate_storage(4 * details::page_size());
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(page_alloc.allocate(1, nullptr)) % details::page_size());
+    free_storage(page_alloc);
+}
+
+TEST_F(linear_allocation_policy_test, test_purge)
+{
+    const size_t PAGES_NUM = 64;
+    const size_t storage_size = PAGES_NUM * details::page_size() / sizeof(int);
+
+    alloc.allocate_storage(storage_size);
+    int* ptr = alloc.allocate(storage_size, nullptr);
+    ptr[0] = ptr[storage_size - 1] = 42;
+    EXPECT_EQ(0u, alloc.purge());
+
+    // the storage is reused from the beginning and its unused tail is given back to the system
+    alloc.set_storage(alloc.get_storage(), storage_size);
+    ptr = alloc.allocate(storage_size / 2, nullptr);
+    size_t purged = alloc.purge();
+#ifdef ALLOC_HAS_PURGE_PAGES
+    EXPECT_GE(purged, (PAGES_NUM / 2 - 1) * details::page_size());
+    EXPECT_EQ(1, stat.purges_count());
+    EXPECT_EQ(purged, stat.purged_mem());
+#endif
+    EXPECT_EQ(0u, alloc.purge());
+    EXPECT_EQ(42, ptr[0]);
+
+    ptr = alloc.allocate(storage_size / 2, nullptr);
+    ptr[storage_size / 2 - 1] = 42;
+    free_storage(alloc);
+}
+
+TEST_F(linear_allocation_policy_test, test_purge_user_storage)
+{
+    const size_t PAGES_NUM = 64;
+    const size_t storage_size = PAGES_NUM * details::page_size() / sizeof(int);
+
+    // storage set by the user is never purged, its free memory keeps the contents
+    std::vector<int> buffer(storage_size, 42);
+    alloc.set_storage(buffer.data(), storage_size);
+    alloc.allocate(storage_size, nullptr);
+    alloc.set_storage(buffer.data(), storage_size);
+    alloc.allocate(storage_size / 2, nullptr);
+    EXPECT_EQ(0u, alloc.purge());
+    EXPECT_EQ(0, stat.purges_count());
+    EXPECT_EQ(42, buffer[storage_size - 1]);
+}
+
+TEST_F(linear_allocation_policy_test, test_rewind)
+{
+    int* ptr1 = alloc.allocate(1, nullptr);
+    int_allocator::marker_type marker = alloc.get_marker();
+    if (true) {
+        linear_allocation_scope<int_allocator> scope(alloc);
+        alloc.allocate(10, nullptr);
+        if (true) {
+            // copies share the storage, so the scope covers their allocations too
+            char_allocator char_alloc(alloc);
+            linear_allocation_scope<char_allocator> nested_scope(char_alloc);
+            char_alloc.allocate(10, nullptr);
+        }
+        EXPECT_EQ(ptr1 + 11, alloc.allocate(1, nullptr));
+    }
+    EXPECT_EQ(marker, alloc.get_marker());
+    EXPECT_EQ(ptr1 + 1, alloc.allocate(1, nullptr));
+
+    // memory of base_policy is not affected by rewind
+    alloc.rewind(0);
+    alloc.allocate(STORAGE_SIZE, nullptr);
+    marker = alloc.get_marker();
+    int* ptr2 = alloc.allocate(1, nullptr);
+    alloc.rewind(marker);
+    EXPECT_FALSE(alloc.is_memory_available(1));
+    alloc.deallocate(ptr2, 1);
+    EXPECT_EQ(1, stat.deallocs_count());
+}
+
+TEST(linear_allocator_test, test_scope)
+{
+    typedef allocator<int, allocation_traits<int>,
+                        linear_allocation_policy<int>,
+                        default_allocation_policy<int>
+                     > int_allocator;
+
+    const size_t SIZE = 1024;
+
+    int_allocator alloc;
+    alloc.allocate_storage(SIZE);
+    for (int i = 0; i < 10; ++i) {
+        linear_allocation_scope<int_allocator> scope(alloc);
+        std::vector<int, int_allocator> vec(alloc);
+        vec.reserve(SIZE / 2);
+        for (int j = 0; j < 100; ++j) {
+            vec.push_back(j);
+        }
+        EXPECT_EQ(alloc.get_storage(), vec.data());
+        EXPECT_EQ(99, vec.back());
+    }
+    EXPECT_TRUE(alloc.is_memory_available(SIZE));
+    free_storage(alloc);
+}
+
+TEST(concurrent_linear_allocation_policy_test, test_threads)
+{
+    typedef concurrent_linear_allocation_policy<std::uint64_t> u64_allocator;
+
+    const size_t THREADS_NUM = 4;
+    const size_t ALLOCS_NUM = 1000;
+
+    u64_allocator alloc;
+    alloc.allocate_storage(THREADS_NUM * ALLOCS_NUM);
+    std::vector<std::vector<std::uint64_t*>> ptrs(THREADS_NUM);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREADS_NUM; ++i) {
+        threads.emplace_back([alloc, i, &ptrs]() mutable {
+            for (size_t j = 0; j < ALLOCS_NUM + 10; ++j) {
+                std::uint64_t* ptr = alloc.allocate(1, nullptr);
+                *ptr = i;
+                ptrs[i].push_back(ptr);
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    // the storage is filled exactly, the rest is allocated from base_policy
+    size_t owned = 0;
+    for (size_t i = 0; i < THREADS_NUM; ++i) {
+        for (std::uint64_t* ptr: ptrs[i]) {
+            EXPECT_EQ(i, *ptr);
+            if (alloc.get_storage() <= ptr && ptr < alloc.get_storage() + THREADS_NUM * ALLOCS_NUM) {
+                ++owned;
+            } else {
+                alloc.deallocate(ptr, 1);
+            }
+        }
+    }
+    EXPECT_EQ(THREADS_NUM * ALLOCS_NUM, owned);
+    free_storage(alloc);
+}
+
+class tlab_linear_allocation_policy_test: public ::testing::Test
+{
+public:
+
+    struct test_tlab_traits: public concurrent_linear_traits
+    {
+        static const size_t TLAB_SIZE = 256;
+    };
+
+    typedef basic_linear_allocation_policy<std::uint64_t, allocation_traits<std::uint64_t>, test_tlab_traits,
+                                            default_allocation_policy<std::uint64_t, allocation_traits<std::uint64_t>,
+                                                statistic_policy<std::uint64_t>
+                                            >
+                                          > u64_allocator;
+
+    typedef typename u64_allocator::statistic_type statistic;
+    typedef typename u64_allocator::tlab_statistic_type tlab_statistic;
+
+    static const size_t STORAGE_SIZE = 1024;
+
+    tlab_linear_allocation_policy_test()
+    {
+        alloc.set_statistic(&stat);
+        alloc.allocate_storage(STORAGE_SIZE);
+    }
+
+    ~tlab_linear_allocation_policy_test()
+    {
+        free_storage(alloc);
+    }
+
+    statistic stat;
+    u64_allocator alloc;
+};
+
+TEST_F(tlab_linear_allocation_policy_test, test_allocate)
+{
+    EXPECT_EQ(0u, alloc.tlab_statistic().buffers_count());
+
+    std::uint64_t* ptr1 = alloc.allocate(2, nullptr);
+    std::uint64_t* ptr2 = alloc.allocate(2, nullptr);
+    EXPECT_EQ(ptr1 + 2, ptr2);
+    tlab_statistic tlab_stat = alloc.tlab_statistic();
+    EXPECT_EQ(1u, tlab_stat.buffers_count());
+    EXPECT_EQ(256u, tlab_stat.buffers_size());
+    EXPECT_EQ(32u, tlab_stat.used());
+    // the rest of the storage is available to other threads, the buffer is aligned by cache line
+    EXPECT_TRUE(alloc.is_memory_available(STORAGE_SIZE - (256 + CACHE_LINE_SIZE) / sizeof(std::uint64_t)));
+    EXPECT_FALSE(alloc.is_memory_available(STORAGE_SIZE - 256 / sizeof(std::uint64_t) + 1));
+
+    // the last allocation from the buffer is freed and resized inside it
+    alloc.deallocate(ptr2, 2);
+    EXPECT_EQ(16u, alloc.tlab_statistic().used());
+    EXPECT_TRUE(alloc.expand(ptr1, 2, 4));
+    EXPECT_EQ(32u, alloc.tlab_statistic().used());
+
+    // large requests bypass the buffer
+    std::uint64_t* large_ptr = alloc.allocate(16, nullptr);
+    EXPECT_EQ(ptr1 + 256 / sizeof(std::uint64_t), large_ptr);
+    EXPECT_EQ(32u, alloc.tlab_statistic().used());
+
+    // the buffer is replaced when it is exhausted
+    for (int i = 0; i < 4; ++i) {
+        alloc.allocate(8, nullptr);
+    }
+    tlab_stat = alloc.tlab_statistic();
+    EXPECT_EQ(2u, tlab_stat.buffers_count());
+    EXPECT_EQ(512u, tlab_stat.buffers_size());
+    EXPECT_EQ(32u, tlab_stat.wasted());
+    EXPECT_EQ(32u + 4 * 64u, tlab_stat.used());
+    EXPECT_EQ(1, stat.allocs_count());
+}
+
+TEST_F(tlab_linear_allocation_policy_test, test_reset)
+{
+    std::uint64_t* ptr = alloc.allocate(1, nullptr);
+    alloc.rewind(0);
+    // the buffer is dropped without waste
+    EXPECT_EQ(ptr, alloc.allocate(1, nullptr));
+    EXPECT_EQ(2u, alloc.tlab_statistic().buffers_count());
+    EXPECT_EQ(0u, alloc.tlab_statistic().wasted());
+
+    alloc.set_storage(alloc.get_storage(), STORAGE_SIZE);
+    EXPECT_EQ(ptr, alloc.allocate(1, nullptr));
+    EXPECT_EQ(3u, alloc.tlab_statistic().buffers_count());
+
+    // the storage is exhausted by buffers
+    std::vector<std::uint64_t*> ptrs;
+    for (size_t i = 0; i < STORAGE_SIZE; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    EXPECT_FALSE(alloc.is_memory_available(1));
+    EXPECT_LT(1, stat.allocs_count());
+    for (std::uint64_t* p: ptrs) {
+        alloc.deallocate(p, 1);
+    }
+}
+
+TEST_F(tlab_linear_allocation_policy_test, test_threads)
+{
+    const size_t THREADS_NUM = 4;
+    const size_t ALLOCS_NUM = 100;
+
+    std::vector<std::vector<std::uint64_t*>> ptrs(THREADS_NUM);
+    std::vector<tlab_statistic> tlab_stats(THREADS_NUM);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREADS_NUM; ++i) {
+        threads.emplace_back([this, i, &ptrs, &tlab_stats] {
+            u64_allocator local_alloc(alloc);
+            for (size_t j = 0; j < ALLOCS_NUM; ++j) {
+                std::uint64_t* ptr = local_alloc.allocate(1, nullptr);
+                *ptr = i;
+                ptrs[i].push_back(ptr);
+            }
+            tlab_stats[i] = local_alloc.tlab_statistic();
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    std::vector<std::uint64_t*> all_ptrs;
+    for (size_t i = 0; i < THREADS_NUM; ++i) {
+        for (std::uint64_t* ptr: ptrs[i]) {
+            EXPECT_EQ(i, *ptr);
+            EXPECT_TRUE(alloc.get_storage() <= ptr && ptr < alloc.get_storage() + STORAGE_SIZE);
+            all_ptrs.push_back(ptr);
+        }
+        EXPECT_EQ(ALLOCS_NUM * sizeof(std::uint64_t), tlab_stats[i].used());
+        EXPECT_EQ(tlab_stats[i].buffers_size(), tlab_stats[i].buffers_count() * 256);
+    }
+    std::sort(all_ptrs.begin(), all_ptrs.end());
+    EXPECT_TRUE(std::adjacent_find(all_ptrs.begin(), all_ptrs.end()) == all_ptrs.end());
+    // the main thread has no buffer
+    EXPECT_EQ(0u, alloc.tlab_statistic().buffers_count());
+}
+
+class linear_arena_test: public ::testing::Test
+{
+public:
+    typedef std::uint8_t byte;
+    typedef linear_arena<byte*, size_t> arena_type;
+
+    static const size_t REGION_SIZE = 64;
+
+    alignas(16) byte mem1[REGION_SIZE];
+    alignas(16) byte mem2[2 * REGION_SIZE];
+    arena_type arena;
+};
+
+TEST_F(linear_arena_test, test_allocate)
+{
+    EXPECT_FALSE(arena.is_memory_available(1));
+    EXPECT_EQ(0u, arena.regions_count());
+
+    arena.add_region(mem1, REGION_SIZE);
+    EXPECT_TRUE(arena.is_memory_available(REGION_SIZE));
+    EXPECT_EQ(mem1, arena.allocate(REGION_SIZE - 8));
+    EXPECT_FALSE(arena.is_memory_available(16));
+
+    // the new region becomes current, the tail of the previous one is left unused
+    arena.add_region(mem2, 2 * REGION_SIZE);
+    EXPECT_EQ(2u, arena.regions_count());
+    EXPECT_EQ(3 * REGION_SIZE, arena.total_size());
+    EXPECT_EQ(mem2, arena.allocate(16));
+    EXPECT_EQ(mem2 + 16, arena.allocate(1));
+    EXPECT_EQ(mem2 + 32, arena.allocate(8, 16));
+}
+
+TEST_F(linear_arena_test, test_is_owned)
+{
+    byte other[REGION_SIZE];
+    byte* regions[] = {mem1, mem2, other};
+    size_t sizes[] = {REGION_SIZE, 2 * REGION_SIZE, REGION_SIZE};
+    for (size_t i = 0; i < 2; ++i) {
+        arena.add_region(regions[i], sizes[i]);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        EXPECT_TRUE(arena.is_owned(regions[i]));
+        EXPECT_TRUE(arena.is_owned(regions[i] + sizes[i] - 1));
+    }
+    EXPECT_FALSE(arena.is_owned(other));
+    EXPECT_FALSE(arena.is_owned(other + REGION_SIZE - 1));
+}
+
+TEST_F(linear_arena_test, test_release)
+{
+    arena.add_region(mem2, 2 * REGION_SIZE);
+    arena.add_region(mem1, REGION_SIZE);
+    arena.allocate(8);
+
+    std::vector<std::pair<byte*, size_t>> released;
+    arena.release([&released](byte* mem, size_t size) {
+        released.emplace_back(mem, size);
+    });
+    ASSERT_EQ(2u, released.size());
+    EXPECT_EQ(mem2, released[0].first);
+    EXPECT_EQ(2 * REGION_SIZE, released[0].second);
+    EXPECT_EQ(mem1, released[1].first);
+    EXPECT_EQ((size_t)REGION_SIZE, released[1].second);
+
+    EXPECT_EQ(0u, arena.regions_count());
+    EXPECT_EQ(0u, arena.total_size());
+    EXPECT_FALSE(arena.is_memory_available(1));
+    EXPECT_FALSE(arena.is_owned(mem1));
+}
+
+class monotonic_allocation_policy_test: public ::testing::Test
+{
+public:
+
+    typedef monotonic_allocation_policy<int, allocation_traits<int>,
+                                            default_allocation_policy<int, allocation_traits<int>,
+                                                statistic_policy<int>
+                                            >
+                                       > int_allocator;
+
+    typedef typename int_allocator::rebind<char> char_allocator;
+    typedef typename int_allocator::statistic_type statistic;
+
+    static const size_t REGION_SIZE = 64;
+
+    monotonic_allocation_policy_test():
+        alloc(REGION_SIZE)
+    {
+        alloc.set_statistic(&stat);
+    }
+
+    statistic stat;
+    int_allocator alloc;
+};
+
+TEST_F(monotonic_allocation_policy_test, test_allocate)
+{
+    EXPECT_EQ(0u, alloc.regions_count());
+
+    std::vector<int*> ptrs;
+    for (size_t i = 0; i < 7 * REGION_SIZE / sizeof(int); ++i) {
+        int* ptr = alloc.allocate(1, nullptr);
+        ASSERT_NE(nullptr, ptr);
+        *ptr = static_cast<int>(i);
+        ptrs.push_back(ptr);
+    }
+    // regions of 64, 128 and 256 bytes
+    EXPECT_EQ(3u, alloc.regions_count());
+    EXPECT_EQ(7 * REGION_SIZE, alloc.total_size());
+    EXPECT_EQ(3, stat.allocs_count());
+    EXPECT_EQ(7 * REGION_SIZE, stat.mem_used());
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+        EXPECT_EQ(static_cast<int>(i), *ptrs[i]);
+        EXPECT_TRUE(alloc.is_owned(ptrs[i]));
+    }
+
+    // a request larger than the next region gets its own region
+    int* large_ptr = alloc.allocate(1000, nullptr);
+    large_ptr[999] = 42;
+    EXPECT_EQ(4u, alloc.regions_count());
+    EXPECT_EQ(4, stat.allocs_count());
+
+    int* ptr = alloc.allocate(1, nullptr);
+    EXPECT_EQ(ptr, alloc.allocate(1, ptr));
+}
+
+TEST_F(monotonic_allocation_policy_test, test_deallocate)
+{
+    int* ptr = alloc.allocate(10, nullptr);
+    alloc.deallocate(ptr, 10);
+    EXPECT_EQ(0, stat.deallocs_count());
+
+    int other = 0;
+    EXPECT_FALSE(alloc.is_owned(&other));
+}
+
+TEST_F(monotonic_allocation_policy_test, test_try_resize)
+{
+    int* ptr1 = alloc.allocate(2, nullptr);
+    EXPECT_TRUE(alloc.expand(ptr1, 2, 4));
+    alloc.deallocate(ptr1, 4);
+    EXPECT_EQ(ptr1, alloc.allocate(1, nullptr));
+
+    // the last allocation can't grow beyond the current region
+    int* ptr2 = alloc.allocate(2, nullptr);
+    EXPECT_FALSE(alloc.expand(ptr2, 2, REGION_SIZE / sizeof(int)));
+    EXPECT_EQ(1u, alloc.regions_count());
+}
+
+TEST_F(monotonic_allocation_policy_test, test_release)
+{
+    for (size_t i = 0; i < 10; ++i) {
+        alloc.allocate(REGION_SIZE / sizeof(int), nullptr);
+    }
+    size_t regions = alloc.regions_count();
+    alloc.release();
+    EXPECT_EQ(regions, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+    EXPECT_EQ(0u, alloc.regions_count());
+
+    // the arena is usable after release and starts again from a region of the first size
+    int* ptr = alloc.allocate(1, nullptr);
+    *ptr = 42;
+    EXPECT_EQ(1u, alloc.regions_count());
+    EXPECT_EQ((size_t)REGION_SIZE, alloc.total_size());
+    EXPECT_EQ((size_t)REGION_SIZE, stat.mem_used());
+}
+
+TEST_F(monotonic_allocation_policy_test, test_copy)
+{
+    char_allocator char_alloc(alloc);
+    EXPECT_TRUE(int_allocator(char_alloc) == alloc);
+    EXPECT_TRUE(alloc != int_allocator());
+
+    if (true) {
+        int_allocator alloc_copy(alloc);
+        alloc_copy.allocate(1, nullptr);
+        char* chars = char_alloc.allocate(3, nullptr);
+        int* ints = alloc.allocate(1, nullptr);
+        // rebinded copies share the regions and allocations are aligned by their own type
+        EXPECT_EQ(1u, alloc.regions_count());
+        EXPECT_TRUE(char_alloc.is_owned(chars));
+        EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(ints) % alignof(int));
+    }
+    // regions are kept while any copy is alive
+    EXPECT_EQ(0, stat.deallocs_count());
+
+    if (true) {
+        int_allocator local_alloc;
+        local_alloc.set_statistic(&stat);
+        char_allocator local_char_alloc(local_alloc);
+        local_alloc.allocate(1, nullptr);
+    }
+    EXPECT_EQ(1, stat.deallocs_count());
+}
+
+TEST_F(monotonic_allocation_policy_test, test_rebind_release)
+{
+    // a region of odd size allocated by the char copy is released by the int one
+    char_allocator char_alloc(alloc);
+    char_alloc.allocate(REGION_SIZE + 1, nullptr);
+    EXPECT_EQ(REGION_SIZE + 1, stat.mem_used());
+    alloc.release();
+    EXPECT_EQ(1, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST(monotonic_allocator_test, test_vector)
+{
+    typedef allocator<int, allocation_traits<int>,
+                        monotonic_allocation_policy<int>,
+                        default_allocation_policy<int>
+                     > int_allocator;
+
+    int_allocator alloc;
+    std::vector<int, int_allocator> vec(alloc);
+    for (int i = 0; i < 10000; ++i) {
+        vec.push_back(i);
+    }
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_EQ(i, vec[i]);
+    }
+}
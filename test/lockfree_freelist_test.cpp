@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "allocator.hpp"
+#include "alloc_policies.hpp"
+#include "details/lockfree_stack.hpp"
+#include "lockfree_freelist.hpp"
+#include "statistic_policy.hpp"
+
+using namespace alloc_utility;
+using alloc_utility::details::lockfree_stack;
+
+TEST(lockfree_stack_test, test_push_pop)
+{
+    void* mem[3][2];
+    lockfree_stack stack;
+    EXPECT_TRUE(stack.empty());
+    EXPECT_EQ(nullptr, stack.pop());
+
+    for (auto& block: mem) {
+        stack.push(block);
+    }
+    EXPECT_FALSE(stack.empty());
+    for (int i = 2; i >= 0; --i) {
+        EXPECT_EQ(static_cast<void*>(mem[i]), stack.pop());
+    }
+    EXPECT_TRUE(stack.empty());
+    EXPECT_EQ(nullptr, stack.pop());
+}
+
+class lockfree_freelist_policy_test: public ::testing::Test
+{
+public:
+
+    typedef std::uint64_t object;
+
+    typedef allocator<object, allocation_traits<object>,
+                        lockfree_freelist_policy<object>,
+                        default_allocation_policy<object>,
+                        statistic_policy<object>
+                     > test_allocator;
+
+    typedef statistic_policy<object>::statistic_type statistic_type;
+};
+
+TEST_F(lockfree_freelist_policy_test, test_reuse)
+{
+    statistic_type stat;
+    if (true) {
+        test_allocator alloc;
+        alloc.set_statistic(&stat);
+
+        object* ptr = alloc.allocate(1);
+        alloc.deallocate(ptr, 1);
+        EXPECT_EQ(1, stat.allocs_count());
+        EXPECT_EQ(0, stat.deallocs_count());
+
+        test_allocator copy(alloc);
+        EXPECT_EQ(ptr, copy.allocate(1));
+        EXPECT_EQ(1, stat.allocs_count());
+        copy.deallocate(ptr, 1);
+
+        // arrays are not cached
+        object* arr = alloc.allocate(2);
+        alloc.deallocate(arr, 2);
+        EXPECT_EQ(2, stat.allocs_count());
+        EXPECT_EQ(1, stat.deallocs_count());
+    }
+    // cached objects are returned to base policy with the last copy of allocator
+    EXPECT_EQ(2, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST_F(lockfree_freelist_policy_test, test_move)
+{
+    statistic_type stat;
+    if (true) {
+        test_allocator alloc;
+        alloc.set_statistic(&stat);
+        test_allocator moved(std::move(alloc));
+
+        // moved-from allocator shares the stack with the new one
+        object* ptr = alloc.allocate(1);
+        alloc.deallocate(ptr, 1);
+        EXPECT_EQ(ptr, moved.allocate(1));
+        EXPECT_EQ(1, stat.allocs_count());
+        moved.deallocate(ptr, 1);
+    }
+    EXPECT_EQ(1, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST_F(lockfree_freelist_policy_test, test_rebind)
+{
+    typedef test_allocator::rebind_t<std::pair<object, object>> pair_allocator;
+
+    statistic_type stat;
+    if (true) {
+        test_allocator alloc;
+        alloc.set_statistic(&stat);
+        EXPECT_TRUE(alloc != test_allocator());
+        object* ptr = alloc.allocate(1);
+
+        if (true) {
+            // the object is deallocated through an equal instance and stays on the shared stack
+            // after that instance is destroyed
+            pair_allocator pair_alloc(alloc);
+            test_allocator other(pair_alloc);
+            EXPECT_TRUE(other == alloc);
+            other.deallocate(ptr, 1);
+        }
+        EXPECT_EQ(0, stat.deallocs_count());
+        EXPECT_EQ(ptr, alloc.allocate(1));
+        alloc.deallocate(ptr, 1);
+    }
+    EXPECT_EQ(1, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST_F(lockfree_freelist_policy_test, test_splice)
+{
+    statistic_type stat;
+    if (true) {
+        test_allocator alloc;
+        alloc.set_statistic(&stat);
+        std::list<object, test_allocator> list1(alloc);
+        if (true) {
+            // nodes allocated for one list are freed by another one with an equal allocator
+            std::list<object, test_allocator> list2(alloc);
+            for (object i = 0; i < 10; ++i) {
+                list2.push_back(i);
+            }
+            list1.splice(list1.end(), list2);
+        }
+        EXPECT_TRUE(list1.get_allocator() == alloc);
+        list1.clear();
+        EXPECT_EQ(0, stat.deallocs_count());
+        for (object i = 0; i < 10; ++i) {
+            list1.push_back(i);
+        }
+        EXPECT_EQ(10, stat.allocs_count());
+    }
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST_F(lockfree_freelist_policy_test, test_list)
+{
+    statistic_type stat;
+    if (true) {
+        test_allocator alloc;
+        alloc.set_statistic(&stat);
+        std::list<object, test_allocator> list(alloc);
+        for (int k = 0; k < 10; ++k) {
+            for (object i = 0; i < 100; ++i) {
+                list.push_back(i);
+            }
+            list.clear();
+        }
+        EXPECT_EQ(100, stat.allocs_count());
+    }
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST(lockfree_freelist_policy_threads_test, test_threads)
+{
+    typedef lockfree_freelist_policy<size_t> freelist_allocator;
+
+    const size_t THREADS_NUM = 4;
+    const size_t ITER_NUM = 20000;
+    const size_t OBJ_NUM = 8;
+
+    freelist_allocator alloc;
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < THREADS_NUM; ++id) {
+        threads.emplace_back([alloc, id] () mutable {
+            std::vector<size_t*> ptrs;
+            for (size_t i = 0; i < ITER_NUM; ++i) {
+                for (size_t j = 0; j < OBJ_NUM; ++j) {
+                    ptrs.push_back(alloc.allocate(1, nullptr));
+                    *ptrs.back() = id;
+                }
+                for (size_t* ptr: ptrs) {
+                    ASSERT_EQ(id, *ptr);
+                    alloc.deallocate(ptr, 1);
+                }
+                ptrs.clear();
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    // objects are not lost: no more than THREADS_NUM * OBJ_NUM distinct objects are cached
+    std::vector<size_t*> ptrs;
+    for (size_t i = 0; i < THREADS_NUM * OBJ_NUM; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    std::sort(ptrs.begin(), ptrs.end());
+    EXPECT_TRUE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+    for (size_t* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+}
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "allocator.hpp"
 #include "alloc_policies.hpp"
+#include "statistic_policy.hpp"
 
 using namespace alloc_utility;
 
@@ -29,3 +34,65 @@ TEST(policies_test, test_bad_alloc_exc)
     alloc.deallocate(nullptr, 0);
 }
 
+
+TEST(policies_test, test_aligned)
+{
+    typedef aligned_allocation_policy<char, allocation_traits<char>,
+                                        statistic_policy<char>
+                                     > aligned_policy;
+    typedef aligned_policy::statistic_type statistic_type;
+
+    statistic_type stat;
+    aligned_policy alloc;
+    alloc.set_statistic(&stat);
+    EXPECT_EQ(1u, alloc.alignment());
+
+    for (size_t alignment: {1, 16, 64, 4096}) {
+        alloc.set_alignment(alignment);
+        std::vector<char*> ptrs;
+        for (size_t size: {1, 7, 100, 5000}) {
+            char* ptr = alloc.allocate(size, nullptr);
+            ASSERT_NE(nullptr, ptr);
+            EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(ptr) % alignment);
+            std::fill(ptr, ptr + size, 'a');
+            ptrs.push_back(ptr);
+        }
+        for (char* ptr: ptrs) {
+            alloc.deallocate(ptr, 1);
+        }
+    }
+    EXPECT_EQ(16, stat.allocs_count());
+    EXPECT_EQ(16, stat.deallocs_count());
+
+    // rebinded copies inherit the alignment, which is never less than alignment of the type
+    alloc.set_alignment(2);
+    typedef aligned_policy::rebind<std::uint64_t> u64_policy;
+    u64_policy u64_alloc(alloc);
+    EXPECT_EQ(alignof(std::uint64_t), u64_alloc.alignment());
+    alloc.set_alignment(128);
+    EXPECT_EQ(128u, u64_policy(alloc).alignment());
+
+    // memory is released regardless of the alignment changed after allocation
+    char* ptr = alloc.allocate(10, nullptr);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(ptr) % 128);
+    alloc.set_alignment(1);
+    alloc.deallocate(ptr, 10);
+    EXPECT_EQ(17, stat.deallocs_count());
+}
+
+TEST(policies_test, test_aligned_vector)
+{
+    struct alignas(64) line
+    {
+        char data[64];
+    };
+
+    typedef allocator<line, allocation_traits<line>,
+                      aligned_allocation_policy<line>
+                     > aligned_allocator;
+    std::vector<line, aligned_allocator> vec;
+    for (int i = 0; i < 100; ++i) {
+        vec.emplace_back();
+        EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(vec.data()) % 64);
+    }
+}
@@ -1,6 +1,12 @@
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <mutex>
 #include <random>
+#include <thread>
+#include <vector>
 #include <functional>
+#include <iterator>
 #include <stack>
 
 #include <gtest/gtest.h>
@@ -8,6 +14,7 @@
 #include "allocator.hpp"
 #include "alloc_policies.hpp"
 #include "details/memory_pool.hpp"
+#include "details/purge.hpp"
 #include "pool_allocation.hpp"
 #include "statistic_policy.hpp"
 
@@ -143,6 +150,58 @@ TEST_F(chunk_test, test_stress)
     }
 }
 
+TEST_F(chunk_test, test_lazy_initialization)
+{
+    const byte PATTERN = 0xAA;
+    std::vector<byte> mem(OBJ_SIZE * CHUNK_SIZE, PATTERN);
+    chunk<byte*, size_t> chk(mem.data(), OBJ_SIZE);
+    EXPECT_TRUE(std::all_of(mem.begin(), mem.end(), [PATTERN](byte b) { return b == PATTERN; }));
+
+    // never used objects are allocated sequentially
+    byte* ptr1 = chk.allocate(OBJ_SIZE);
+    byte* ptr2 = chk.allocate(OBJ_SIZE);
+    EXPECT_EQ(mem.data(), ptr1);
+    EXPECT_EQ(mem.data() + OBJ_SIZE, ptr2);
+    EXPECT_TRUE(std::all_of(mem.begin() + 2 * OBJ_SIZE, mem.end(), [PATTERN](byte b) { return b == PATTERN; }));
+
+    // deallocated objects are reused before never used ones
+    chk.deallocate(ptr1, OBJ_SIZE);
+    EXPECT_EQ(ptr1, chk.allocate(OBJ_SIZE));
+    EXPECT_EQ(mem.data() + 2 * OBJ_SIZE, chk.allocate(OBJ_SIZE));
+    EXPECT_TRUE(std::all_of(mem.begin() + 3 * OBJ_SIZE, mem.end(), [PATTERN](byte b) { return b == PATTERN; }));
+}
+
+TEST(wide_chunk_test, test_allocate)
+{
+    typedef std::uint8_t byte;
+    typedef chunk<byte*, size_t, std::uint16_t> wide_chunk;
+
+    const int CHUNK_SIZE = 1000;
+    const int OBJ_SIZE = wide_chunk::MIN_OBJ_SIZE;
+    std::vector<byte> mem(CHUNK_SIZE * OBJ_SIZE);
+    wide_chunk chk(mem.data(), OBJ_SIZE, CHUNK_SIZE);
+    EXPECT_EQ(CHUNK_SIZE, chk.size());
+
+    std::vector<byte*> ptrs;
+    for (int i = 0; i < CHUNK_SIZE; ++i) {
+        byte* ptr = chk.allocate(OBJ_SIZE);
+        ASSERT_TRUE(chk.is_owned(ptr, OBJ_SIZE));
+        ptrs.push_back(ptr);
+    }
+    EXPECT_FALSE(chk.is_memory_available());
+    std::sort(ptrs.begin(), ptrs.end());
+    EXPECT_TRUE(std::unique(ptrs.begin(), ptrs.end()) == ptrs.end());
+
+    for (int i = 0; i < CHUNK_SIZE; i += 2) {
+        chk.deallocate(ptrs[i], OBJ_SIZE);
+    }
+    for (int i = 0; i < CHUNK_SIZE; i += 2) {
+        byte* ptr = chk.allocate(OBJ_SIZE);
+        EXPECT_TRUE(std::binary_search(ptrs.begin(), ptrs.end(), ptr));
+    }
+    EXPECT_FALSE(chk.is_memory_available());
+}
+
 class memory_block_test: public ::testing::Test
 {
 public:
@@ -256,6 +315,19 @@ TEST_F(memory_block_test, test_stress)
     }
 }
 
+TEST_F(memory_block_test, test_lazy_initialization)
+{
+    const byte PATTERN = 0xAA;
+    std::vector<byte> mem(OBJ_SIZE * BLOCK_SIZE, PATTERN);
+    memory_block<byte*, size_t> blk(mem.data(), OBJ_SIZE, BLOCK_SIZE);
+    EXPECT_TRUE(std::all_of(mem.begin(), mem.end(), [PATTERN](byte b) { return b == PATTERN; }));
+
+    for (int i = 0; i < BLOCK_SIZE; ++i) {
+        EXPECT_EQ(mem.data() + i * OBJ_SIZE, blk.allocate(OBJ_SIZE).first);
+    }
+    EXPECT_FALSE(blk.is_memory_available());
+}
+
 class memory_pool_test: public ::testing::Test
 {
 public:
@@ -387,6 +459,260 @@ TEST_F(memory_pool_test, test_deallocate)
     EXPECT_NE(nullptr, ptr);
 }
 
+TEST_F(memory_pool_test, test_many_blocks)
+{
+    const int BLOCKS_NUM = 64;
+    std::vector<byte*> mems;
+    for (int i = 0; i < BLOCKS_NUM; ++i) {
+        mems.push_back(new byte[OBJ_NUM * OBJ_SIZE]);
+    }
+    // add blocks in order that differs from the order of their addresses
+    std::shuffle(mems.begin(), mems.end(), std::default_random_engine(42));
+    for (byte* mem: mems) {
+        pool.add_mem_block(mem, OBJ_NUM);
+    }
+
+    std::vector<byte*> ptrs;
+    for (int i = 0; i < BLOCKS_NUM * OBJ_NUM; ++i) {
+        byte* ptr = pool.allocate();
+        ASSERT_TRUE(pool.is_owned(ptr));
+        ptrs.push_back(ptr);
+    }
+    EXPECT_FALSE(pool.is_memory_available());
+    for (byte* mem: mems) {
+        EXPECT_TRUE(pool.is_owned(mem));
+        EXPECT_TRUE(pool.is_owned(mem + OBJ_NUM * OBJ_SIZE - 1));
+    }
+
+    std::shuffle(ptrs.begin(), ptrs.end(), std::default_random_engine(42));
+    for (byte* ptr: ptrs) {
+        pool.deallocate(ptr);
+    }
+    for (int i = 0; i < BLOCKS_NUM * OBJ_NUM; ++i) {
+        EXPECT_NE(nullptr, pool.allocate());
+    }
+    EXPECT_FALSE(pool.is_memory_available());
+
+    for (byte* mem: mems) {
+        delete[] mem;
+    }
+}
+
+TEST_F(memory_pool_test, test_allocate_after_deallocate)
+{
+    pool.add_mem_block(mem1, OBJ_NUM);
+    pool.add_mem_block(mem2, OBJ_NUM);
+
+    std::vector<byte*> ptrs;
+    for (int i = 0; i < 2 * OBJ_NUM - 2; ++i) {
+        ptrs.push_back(pool.allocate());
+    }
+    EXPECT_EQ(2u, pool.available());
+
+    // freed object is reused by the next allocation even if other blocks have free objects
+    for (byte* ptr: {ptrs.front(), ptrs.back(), ptrs[OBJ_NUM / 2]}) {
+        pool.deallocate(ptr);
+        EXPECT_EQ(3u, pool.available());
+        EXPECT_EQ(ptr, pool.allocate());
+        EXPECT_EQ(2u, pool.available());
+    }
+
+    pool.allocate();
+    pool.allocate();
+    EXPECT_FALSE(pool.is_memory_available());
+    EXPECT_EQ(nullptr, pool.allocate());
+}
+
+TEST_F(memory_pool_test, test_allocate_prefetch)
+{
+    pool.add_mem_block(mem1, OBJ_NUM);
+
+    std::vector<byte*> ptrs;
+    for (int i = 0; i < OBJ_NUM; ++i) {
+        ptrs.push_back(pool.allocate(true));
+    }
+    EXPECT_FALSE(pool.is_memory_available());
+
+    // prefetch doesn't change the order of reused objects
+    for (int i = 0; i < OBJ_NUM; i += 2) {
+        pool.deallocate(ptrs[i]);
+    }
+    for (int i = OBJ_NUM - 2; i >= 0; i -= 2) {
+        EXPECT_EQ(ptrs[i], pool.allocate(true));
+    }
+    EXPECT_FALSE(pool.is_memory_available());
+}
+
+TEST_F(memory_pool_test, test_allocate_batch)
+{
+    pool.add_mem_block(mem1, OBJ_NUM);
+    pool.add_mem_block(mem2, OBJ_NUM);
+
+    // free list of the chunk is consumed before its never used objects
+    byte* ptr1 = pool.allocate();
+    byte* ptr2 = pool.allocate();
+    pool.deallocate(ptr1);
+
+    std::vector<byte*> ptrs;
+    pool.allocate_batch(2 * OBJ_NUM - 1, [&ptrs](byte* ptr) { ptrs.push_back(ptr); });
+    EXPECT_EQ(2u * OBJ_NUM - 1, ptrs.size());
+    EXPECT_FALSE(pool.is_memory_available());
+
+    ptrs.push_back(ptr2);
+    std::sort(ptrs.begin(), ptrs.end());
+    EXPECT_TRUE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+    for (byte* ptr: ptrs) {
+        EXPECT_TRUE(pool.is_owned(ptr));
+        *ptr = 42;
+    }
+
+    for (byte* ptr: ptrs) {
+        EXPECT_TRUE(pool.deallocate(ptr));
+    }
+    EXPECT_EQ(2u * OBJ_NUM, pool.available());
+}
+
+TEST_F(memory_pool_test, test_trim)
+{
+    byte mem3[OBJ_NUM * OBJ_SIZE];
+    pool.add_mem_block(mem1, OBJ_NUM);
+    pool.add_mem_block(mem2, OBJ_NUM);
+    pool.add_mem_block(mem3, OBJ_NUM);
+    EXPECT_EQ(3u, pool.empty_blocks());
+
+    byte* ptr = pool.allocate();
+    EXPECT_EQ(2u, pool.empty_blocks());
+
+    std::vector<byte*> released;
+    auto release = [&released](byte* mem, size_t size) {
+        EXPECT_EQ((size_t)OBJ_NUM, size);
+        released.push_back(mem);
+    };
+
+    // one empty block is kept
+    EXPECT_EQ((size_t)OBJ_NUM, pool.trim(1, release));
+    EXPECT_EQ(1u, released.size());
+    EXPECT_EQ(2u * OBJ_NUM, pool.capacity());
+    EXPECT_EQ(2u * OBJ_NUM - 1, pool.available());
+    EXPECT_EQ(1u, pool.empty_blocks());
+    EXPECT_FALSE(pool.is_owned(released[0]));
+    EXPECT_TRUE(pool.is_owned(ptr));
+    EXPECT_EQ(0u, pool.trim(1, release));
+
+    // block with allocated object is never released
+    EXPECT_EQ((size_t)OBJ_NUM, pool.trim(0, release));
+    EXPECT_EQ(2u, released.size());
+    EXPECT_EQ((size_t)OBJ_NUM, pool.capacity());
+    EXPECT_EQ(0u, pool.empty_blocks());
+
+    std::vector<byte*> ptrs;
+    while (pool.is_memory_available()) {
+        ptrs.push_back(pool.allocate());
+        EXPECT_TRUE(pool.is_owned(ptrs.back()));
+    }
+    EXPECT_EQ(OBJ_NUM - 1u, ptrs.size());
+    ptrs.push_back(ptr);
+    for (byte* p: ptrs) {
+        EXPECT_TRUE(pool.deallocate(p));
+    }
+    EXPECT_EQ(1u, pool.empty_blocks());
+    EXPECT_EQ((size_t)OBJ_NUM, pool.trim(0, release));
+    EXPECT_EQ(0u, pool.capacity());
+    EXPECT_FALSE(pool.is_memory_available());
+}
+
+TEST_F(memory_pool_test, test_purge)
+{
+    pool.add_mem_block(mem1, OBJ_NUM);
+
+    std::vector<std::pair<byte*, size_t>> ranges;
+    auto purge = [&ranges](byte* mem, size_t size) {
+        ranges.emplace_back(mem, size);
+        // simulate discarded memory
+        std::fill(mem, mem + size, 0xFF);
+        return size;
+    };
+
+    // memory which was never used is not purged
+    EXPECT_EQ(0u, pool.purge(10, 0, purge));
+
+    std::vector<byte*> ptrs;
+    for (int i = 0; i < OBJ_NUM / 2; ++i) {
+        ptrs.push_back(pool.allocate());
+    }
+    for (byte* ptr: ptrs) {
+        pool.deallocate(ptr);
+    }
+
+    // chunk is idle since the first purge which finds it empty
+    EXPECT_EQ(0u, pool.purge(20, 5, purge));
+    EXPECT_EQ(0u, pool.purge(24, 5, purge));
+    EXPECT_EQ(24u, pool.last_purge());
+
+    // allocation removes the mark
+    pool.deallocate(pool.allocate());
+    EXPECT_EQ(0u, pool.purge(25, 5, purge));
+    EXPECT_TRUE(ranges.empty());
+
+    EXPECT_EQ((size_t)OBJ_NUM * OBJ_SIZE, pool.purge(30, 5, purge));
+    ASSERT_EQ(1u, ranges.size());
+    EXPECT_EQ(mem1, ranges[0].first);
+    EXPECT_EQ((size_t)OBJ_NUM * OBJ_SIZE, ranges[0].second);
+    EXPECT_EQ(0u, pool.purge(40, 5, purge));
+
+    // the pool doesn't read discarded memory
+    EXPECT_EQ((size_t)OBJ_NUM, pool.available());
+    ptrs.clear();
+    while (pool.is_memory_available()) {
+        ptrs.push_back(pool.allocate());
+        EXPECT_TRUE(pool.is_owned(ptrs.back()));
+    }
+    EXPECT_EQ((size_t)OBJ_NUM, ptrs.size());
+    std::sort(ptrs.begin(), ptrs.end());
+    EXPECT_TRUE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+}
+
+TEST(pools_manager_test, test_get_pool)
+{
+    typedef details::pools_manager<std::uint8_t*, size_t> manager_type;
+    typedef manager_type::pool_type pool_type;
+
+    const size_t LARGE_OBJ_SIZE = manager_type::MAX_INDEXED_OBJ_SIZE + 1;
+
+    manager_type manager;
+    EXPECT_EQ(nullptr, manager.get_pool(sizeof(int), std::nothrow));
+
+    for (size_t obj_size: {sizeof(int), LARGE_OBJ_SIZE}) {
+        pool_type* pool = manager.get_pool(obj_size);
+        ASSERT_NE(nullptr, pool);
+        EXPECT_EQ(obj_size, pool->obj_size());
+        EXPECT_EQ(1, manager.get_pool_ref_count(obj_size));
+
+        EXPECT_EQ(pool, manager.get_pool(obj_size));
+        EXPECT_EQ(pool, manager.get_pool(obj_size, std::nothrow));
+        EXPECT_EQ(3, manager.get_pool_ref_count(obj_size));
+
+        EXPECT_EQ(2, manager.release_pool(obj_size));
+        EXPECT_EQ(1, manager.release_pool(obj_size));
+        EXPECT_EQ(0, manager.release_pool(obj_size));
+    }
+    int pools_count = 0;
+    for (auto it = manager.begin(); it != manager.end(); ++it) {
+        ++pools_count;
+    }
+    EXPECT_EQ(2, pools_count);
+
+    manager.erase_pool(sizeof(int));
+    EXPECT_EQ(nullptr, manager.get_pool(sizeof(int), std::nothrow));
+    EXPECT_EQ(0, manager.get_pool_ref_count(sizeof(int)));
+    EXPECT_TRUE(++manager.begin() == manager.end());
+    EXPECT_EQ(LARGE_OBJ_SIZE, manager.begin()->obj_size());
+
+    manager.erase_pool(LARGE_OBJ_SIZE);
+    EXPECT_EQ(nullptr, manager.get_pool(LARGE_OBJ_SIZE, std::nothrow));
+    EXPECT_TRUE(manager.begin() == manager.end());
+}
+
 class pool_allocation_policy_test: public ::testing::Test
 {
 public:
@@ -591,3 +917,990 @@ TEST_F(pool_allocation_policy_test, test_destruct)
     EXPECT_EQ(0, s.allocated_blocks_count());
     EXPECT_EQ(0, s.mem_used());
 }
+
+TEST_F(pool_allocation_policy_test, test_allocate_batch)
+{
+    const size_t BATCH_SIZE = alloc.block_size() + 10;
+
+    std::vector<int*> ptrs;
+    alloc.allocate_batch(BATCH_SIZE, std::back_inserter(ptrs));
+    ASSERT_EQ(BATCH_SIZE, ptrs.size());
+    // the pool grows by single block for the whole batch
+    EXPECT_EQ(1, stat.allocs_count());
+    EXPECT_EQ(BATCH_SIZE, alloc.capacity());
+    for (int* ptr: ptrs) {
+        *ptr = 42;
+    }
+    std::vector<int*> sorted(ptrs);
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_TRUE(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+    alloc.deallocate_batch(ptrs.begin(), ptrs.end());
+    EXPECT_EQ(0, stat.deallocs_count());
+
+    // deallocated objects are reused
+    int* batch[10];
+    EXPECT_EQ(batch + 10, alloc.allocate_batch(10, batch));
+    EXPECT_EQ(1, stat.allocs_count());
+    alloc.deallocate_batch(batch, batch + 10);
+}
+
+TEST_F(pool_allocation_policy_test, test_deallocate_batch)
+{
+    char_allocator char_alloc(alloc);
+    std::vector<int*> ptrs;
+    for (int i = 0; i < 10; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    // objects of other pools are deallocated one by one
+    ptrs.insert(ptrs.begin() + 5, reinterpret_cast<int*>(char_alloc.allocate(1, nullptr)));
+
+    alloc.deallocate_batch(ptrs.begin(), ptrs.end());
+    EXPECT_EQ(alloc.block_size(), alloc.capacity());
+    EXPECT_EQ(reinterpret_cast<char*>(ptrs[5]), char_alloc.allocate(1, nullptr));
+}
+
+TEST_F(pool_allocation_policy_test, test_trim)
+{
+    std::vector<int*> ptrs;
+    for (size_t i = 0; i < 3 * alloc.block_size(); ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    int* live = alloc.allocate(1, nullptr);
+    *live = 42;
+    EXPECT_EQ(4, stat.allocated_blocks_count());
+    EXPECT_EQ(0u, alloc.trim());
+
+    for (int* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+    EXPECT_EQ(2 * alloc.block_size(), alloc.trim(1));
+    EXPECT_EQ(2, stat.deallocs_count());
+    EXPECT_EQ(2, stat.allocated_blocks_count());
+    EXPECT_EQ(2 * alloc.block_size(), alloc.capacity());
+
+    alloc.shrink_to_fit();
+    EXPECT_EQ(3, stat.deallocs_count());
+    EXPECT_EQ(alloc.block_size(), alloc.capacity());
+    EXPECT_EQ(42, *live);
+
+    // pool is able to grow again after trimming
+    for (size_t i = 0; i < 2 * alloc.block_size(); ++i) {
+        ptrs[i] = alloc.allocate(1, nullptr);
+        *ptrs[i] = 42;
+    }
+    EXPECT_EQ(3 * alloc.block_size(), alloc.capacity());
+    alloc.deallocate(live, 1);
+    alloc.deallocate_batch(ptrs.begin(), ptrs.begin() + 2 * alloc.block_size());
+    EXPECT_EQ(3 * alloc.block_size(), alloc.trim());
+    EXPECT_EQ(0, stat.allocated_blocks_count());
+}
+
+namespace
+{
+
+struct auto_trim_pool_traits: public default_pool_traits
+{
+    static const std::size_t AUTO_TRIM_PERCENT = 50;
+    static const std::size_t AUTO_TRIM_SPARE_BLOCKS = 1;
+};
+
+}
+
+TEST(auto_trim_pool_allocation_policy_test, test_deallocate)
+{
+    typedef basic_pool_allocation_policy<int, allocation_traits<int>, auto_trim_pool_traits,
+                                            default_allocation_policy<int, allocation_traits<int>,
+                                                statistic_policy<int>
+                                            >
+                                        > auto_trim_allocator;
+    typedef typename auto_trim_allocator::statistic_type statistic;
+
+    const size_t BLOCK_SIZE = 16;
+    const size_t BLOCKS_NUM = 8;
+
+    statistic stat;
+    auto_trim_allocator alloc(BLOCK_SIZE);
+    alloc.set_statistic(&stat);
+
+    std::vector<int*> ptrs;
+    for (size_t i = 0; i < BLOCKS_NUM * BLOCK_SIZE; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    EXPECT_EQ(BLOCKS_NUM, stat.allocated_blocks_count());
+
+    // free objects scattered over all blocks don't release anything
+    for (size_t i = 0; i < ptrs.size(); i += 2) {
+        alloc.deallocate(ptrs[i], 1);
+    }
+    EXPECT_EQ(BLOCKS_NUM, stat.allocated_blocks_count());
+
+    for (size_t i = 1; i < ptrs.size(); i += 2) {
+        alloc.deallocate(ptrs[i], 1);
+    }
+    EXPECT_EQ(1, stat.allocated_blocks_count());
+    EXPECT_EQ(BLOCK_SIZE, alloc.capacity());
+}
+
+TEST_F(pool_allocation_policy_test, test_purge)
+{
+    // adjacent empty chunks are purged together, so the range spans whole pages
+    const size_t BLOCK_SIZE = 16 * details::page_size() / sizeof(int);
+
+    int_allocator purged_alloc(BLOCK_SIZE);
+    purged_alloc.set_statistic(&stat);
+
+    std::vector<int*> ptrs;
+    purged_alloc.allocate_batch(BLOCK_SIZE, std::back_inserter(ptrs));
+    for (int* ptr: ptrs) {
+        *ptr = 42;
+    }
+    EXPECT_EQ(0u, purged_alloc.purge());
+
+    int* live = ptrs.back();
+    ptrs.pop_back();
+    purged_alloc.deallocate_batch(ptrs.begin(), ptrs.end());
+
+    // idle memory is purged by the first call with zero decay
+    size_t purged = purged_alloc.purge();
+#ifdef ALLOC_HAS_PURGE_PAGES
+    EXPECT_GE(purged, 8 * details::page_size());
+    EXPECT_EQ(1, stat.purges_count());
+    EXPECT_EQ(purged, stat.purged_mem());
+#endif
+    EXPECT_EQ(0u, purged_alloc.purge());
+    EXPECT_EQ(42, *live);
+
+    // purged memory is still owned by the pool
+    EXPECT_EQ(BLOCK_SIZE, purged_alloc.capacity());
+    ptrs.clear();
+    purged_alloc.allocate_batch(BLOCK_SIZE - 1, std::back_inserter(ptrs));
+    for (int* ptr: ptrs) {
+        *ptr = 42;
+    }
+    EXPECT_EQ(1, stat.allocs_count());
+    EXPECT_EQ(42, *live);
+    purged_alloc.deallocate_batch(ptrs.begin(), ptrs.end());
+    purged_alloc.deallocate(live, 1);
+
+    // decay delays purge of idle memory
+    EXPECT_EQ(0u, purged_alloc.purge(std::chrono::milliseconds(60000)));
+}
+
+TEST(batch_allocator_test, test_propagation)
+{
+    typedef allocator<int, allocation_traits<int>,
+                      pool_allocation_policy<int>,
+                      default_allocation_policy<int>,
+                      statistic_policy<int>
+                     > pool_allocator;
+    typedef allocator<int, allocation_traits<int>,
+                      statistic_policy<int>,
+                      default_allocation_policy<int>
+                     > plain_allocator;
+
+    static_assert(details::supports_batch_allocation<pool_allocation_policy<int>>::value,
+                  "pool_allocation_policy should support batch allocation");
+    static_assert(!details::supports_batch_allocation<statistic_policy<int>>::value,
+                  "statistic_policy shouldn't support batch allocation");
+
+    statistic_policy<int>::statistic_type stat;
+    int* ptrs[8];
+
+    // batch is served by pool_allocation_policy
+    pool_allocator pool_alloc;
+    pool_alloc.set_statistic(&stat);
+    pool_alloc.allocate_batch(8, ptrs);
+    EXPECT_EQ(1, stat.allocs_count());
+    pool_alloc.deallocate_batch(ptrs, ptrs + 8);
+    EXPECT_EQ(0, stat.deallocs_count());
+
+    // policies without batch operations are called for each object
+    statistic_policy<int>::statistic_type plain_stat;
+    plain_allocator plain_alloc;
+    plain_alloc.set_statistic(&plain_stat);
+    plain_alloc.allocate_batch(8, ptrs);
+    EXPECT_EQ(8, plain_stat.allocs_count());
+    plain_alloc.deallocate_batch(ptrs, ptrs + 8);
+    EXPECT_EQ(8, plain_stat.deallocs_count());
+}
+
+namespace
+{
+
+struct auto_purge_pool_traits: public default_pool_traits
+{
+    static const std::size_t PURGE_DECAY_MS = 1;
+};
+
+}
+
+TEST(auto_purge_pool_allocation_policy_test, test_deallocate)
+{
+    typedef basic_pool_allocation_policy<int, allocation_traits<int>, auto_purge_pool_traits,
+                                            default_allocation_policy<int, allocation_traits<int>,
+                                                statistic_policy<int>
+                                            >
+                                        > auto_purge_allocator;
+    typedef typename auto_purge_allocator::statistic_type statistic;
+
+    const size_t BLOCK_SIZE = 16 * details::page_size() / sizeof(int);
+
+    statistic stat;
+    auto_purge_allocator alloc(BLOCK_SIZE);
+    alloc.set_statistic(&stat);
+
+    std::vector<int*> ptrs;
+    alloc.allocate_batch(BLOCK_SIZE, std::back_inserter(ptrs));
+    alloc.deallocate_batch(ptrs.begin() + 1, ptrs.end());
+
+    // idle chunks are found by deallocations, which read the clock once per a few hundreds of calls
+    for (int i = 0; i < 100 && stat.purges_count() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        for (int j = 0; j < 1000; ++j) {
+            alloc.deallocate(alloc.allocate(1, nullptr), 1);
+        }
+    }
+#ifdef ALLOC_HAS_PURGE_PAGES
+    EXPECT_LT(0, stat.purges_count());
+    EXPECT_LE(8 * details::page_size(), stat.purged_mem());
+#endif
+    EXPECT_EQ(1, stat.allocs_count());
+    alloc.deallocate(ptrs[0], 1);
+}
+
+TEST(pool_growth_test, test_fixed)
+{
+    fixed_pool_growth growth;
+    EXPECT_EQ(16u, growth.next_block_size<size_t>(16, 0, 0));
+    EXPECT_EQ(16u, growth.next_block_size<size_t>(16, 1024, 0));
+}
+
+TEST(pool_growth_test, test_geometric)
+{
+    geometric_pool_growth<100> growth;
+    EXPECT_EQ(16u, growth.next_block_size<size_t>(16, 0, 0));
+    EXPECT_EQ(16u, growth.next_block_size<size_t>(16, 16, 0));
+    EXPECT_EQ(32u, growth.next_block_size<size_t>(16, 32, 0));
+    EXPECT_EQ(64u, growth.next_block_size<size_t>(16, 64, 0));
+    EXPECT_EQ(100u, growth.next_block_size<size_t>(16, 128, 0));
+    EXPECT_EQ(200u, growth.next_block_size<size_t>(200, 128, 0));
+}
+
+TEST(pool_growth_test, test_demand)
+{
+    demand_pool_growth<1000, 100> growth;
+    // there is no history on the first growth
+    EXPECT_EQ(16u, growth.next_block_size<size_t>(16, 0, 0));
+    // 16 objects are allocated in much less than a second
+    EXPECT_EQ(100u, growth.next_block_size<size_t>(16, 16, 0));
+    // allocated objects don't grow
+    EXPECT_EQ(16u, growth.next_block_size<size_t>(16, 116, 100));
+
+    demand_pool_growth<1, 100> short_growth;
+    short_growth.next_block_size<size_t>(16, 0, 0);
+    size_t size = short_growth.next_block_size<size_t>(16, 16, 0);
+    EXPECT_LE(16u, size);
+    EXPECT_GE(100u, size);
+}
+
+namespace
+{
+
+template <typename strategy>
+struct growth_pool_traits: public default_pool_traits
+{
+    typedef strategy growth_strategy;
+};
+
+template <typename strategy>
+using growth_pool_allocator = basic_pool_allocation_policy<int, allocation_traits<int>, growth_pool_traits<strategy>,
+                                    default_allocation_policy<int, allocation_traits<int>,
+                                        statistic_policy<int>
+                                    >
+                                >;
+
+}
+
+TEST(geometric_pool_allocation_policy_test, test_allocate)
+{
+    typedef growth_pool_allocator<geometric_pool_growth<64>> geometric_allocator;
+    typedef typename geometric_allocator::statistic_type statistic;
+
+    statistic stat;
+    geometric_allocator alloc(16);
+    alloc.set_statistic(&stat);
+
+    std::vector<int*> ptrs;
+    for (size_t i = 0; i < 256; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    // blocks of 16, 16, 32, 64, 64, 64 objects
+    EXPECT_EQ(6u, stat.allocs_count());
+    EXPECT_EQ(256u, alloc.capacity());
+
+    // the batch gets the block of the strategy if it is larger than the batch
+    alloc.allocate_batch(10, std::back_inserter(ptrs));
+    EXPECT_EQ(7u, stat.allocs_count());
+    EXPECT_EQ(320u, alloc.capacity());
+
+    for (int* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+}
+
+TEST(demand_pool_allocation_policy_test, test_allocate)
+{
+    typedef growth_pool_allocator<demand_pool_growth<1000, 1024>> demand_allocator;
+    typedef typename demand_allocator::statistic_type statistic;
+
+    statistic stat;
+    demand_allocator alloc(16);
+    alloc.set_statistic(&stat);
+
+    std::vector<int*> ptrs;
+    for (size_t i = 0; i < 4096; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    // the burst is detected after the second block
+    EXPECT_GT(16u, stat.allocs_count());
+    EXPECT_LE(4096u, alloc.capacity());
+
+    for (int* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+}
+
+TEST(cache_aligned_pool_allocation_policy_test, test_allocate)
+{
+    typedef cache_aligned_pool_allocation_policy<int, allocation_traits<int>,
+                                                    default_allocation_policy<int, allocation_traits<int>,
+                                                        statistic_policy<int>
+                                                    >
+                                                > cache_aligned_allocator;
+    typedef typename cache_aligned_allocator::statistic_type statistic;
+
+    EXPECT_EQ(CACHE_LINE_SIZE, cache_aligned_allocator::SLOT_SIZE);
+
+    statistic stat;
+    if (true) {
+        cache_aligned_allocator alloc(10);
+        alloc.set_statistic(&stat);
+
+        std::vector<int*> ptrs;
+        for (int i = 0; i < 25; ++i) {
+            int* ptr = alloc.allocate(1, nullptr);
+            EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(ptr) % CACHE_LINE_SIZE);
+            *ptr = i;
+            ptrs.push_back(ptr);
+        }
+        EXPECT_EQ(3, stat.allocs_count());
+        for (int i = 0; i < 25; ++i) {
+            EXPECT_EQ(i, *ptrs[i]);
+            alloc.deallocate(ptrs[i], 1);
+        }
+
+        // over-allocated blocks are given back to base_policy as they were allocated
+        EXPECT_EQ(30u, alloc.trim(0));
+        EXPECT_EQ(3, stat.deallocs_count());
+        EXPECT_EQ(0, stat.mem_used());
+
+        alloc.allocate(1, nullptr);
+    }
+    EXPECT_EQ(4, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST(cache_aligned_pool_allocation_policy_test, test_rebind)
+{
+    struct alignas(64) line
+    {
+        char data[64];
+    };
+
+    typedef cache_aligned_pool_allocation_policy<char, allocation_traits<char>,
+                                                    default_allocation_policy<char, allocation_traits<char>,
+                                                        statistic_policy<char>
+                                                    >
+                                                > char_allocator;
+    typedef char_allocator::rebind<line> line_allocator;
+    typedef typename char_allocator::statistic_type statistic;
+
+    EXPECT_EQ(char_allocator::SLOT_SIZE, line_allocator::SLOT_SIZE);
+
+    statistic stat;
+    line_allocator* line_alloc = nullptr;
+    if (true) {
+        // blocks of the shared pool are allocated by a copy of one type
+        char_allocator alloc(10);
+        alloc.set_statistic(&stat);
+        char* ptr = alloc.allocate(1, nullptr);
+        EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(ptr) % CACHE_LINE_SIZE);
+        alloc.deallocate(ptr, 1);
+
+        line_alloc = new line_allocator(alloc);
+        line* l = line_alloc->allocate(1, nullptr);
+        EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(l) % alignof(line));
+        line_alloc->deallocate(l, 1);
+        EXPECT_EQ(1, stat.allocs_count());
+    }
+    // and released by a copy of the other one
+    delete line_alloc;
+    EXPECT_EQ(1, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+namespace
+{
+
+struct colored_pool_traits: public default_pool_traits
+{
+    static const std::size_t CACHE_COLORS = 4;
+};
+
+}
+
+TEST(colored_pool_allocation_policy_test, test_allocate)
+{
+    typedef basic_pool_allocation_policy<int, allocation_traits<int>, colored_pool_traits,
+                                            aligned_allocation_policy<int, allocation_traits<int>,
+                                                statistic_policy<int>
+                                            >
+                                        > colored_allocator;
+    typedef typename colored_allocator::statistic_type statistic;
+
+    const size_t BLOCK_SIZE = 16;
+    const size_t PAGE_SIZE = 4096;
+
+    statistic stat;
+    if (true) {
+        colored_allocator alloc(BLOCK_SIZE);
+        alloc.set_statistic(&stat);
+        // upstream blocks are page aligned, so offsets of blocks inside pages are their colors
+        alloc.set_alignment(PAGE_SIZE);
+
+        std::vector<int*> ptrs;
+        std::vector<size_t> offsets;
+        for (size_t i = 0; i < 6 * BLOCK_SIZE; ++i) {
+            int* ptr = alloc.allocate(1, nullptr);
+            *ptr = 42;
+            ptrs.push_back(ptr);
+        }
+        EXPECT_EQ(6, stat.allocs_count());
+        for (int* ptr: ptrs) {
+            offsets.push_back(reinterpret_cast<std::uintptr_t>(ptr) % PAGE_SIZE);
+        }
+        std::sort(offsets.begin(), offsets.end());
+        // 6 blocks of 4 colors, the first slots of blocks are one cache line apart
+        size_t first_offset = offsets[0];
+        EXPECT_EQ(2u, std::count(offsets.begin(), offsets.end(), first_offset));
+        EXPECT_EQ(2u, std::count(offsets.begin(), offsets.end(), first_offset + CACHE_LINE_SIZE));
+        EXPECT_EQ(1u, std::count(offsets.begin(), offsets.end(), first_offset + 2 * CACHE_LINE_SIZE));
+        EXPECT_EQ(1u, std::count(offsets.begin(), offsets.end(), first_offset + 3 * CACHE_LINE_SIZE));
+
+        for (int* ptr: ptrs) {
+            alloc.deallocate(ptr, 1);
+        }
+        EXPECT_EQ(6 * BLOCK_SIZE, alloc.trim(0));
+        EXPECT_EQ(0, stat.mem_used());
+    }
+    EXPECT_EQ(6, stat.deallocs_count());
+}
+
+TEST(colored_pool_allocation_policy_test, test_copy)
+{
+    typedef basic_pool_allocation_policy<int, allocation_traits<int>, colored_pool_traits,
+                                            aligned_allocation_policy<int, allocation_traits<int>>
+                                        > colored_allocator;
+
+    const size_t BLOCK_SIZE = 16;
+    const size_t PAGE_SIZE = 4096;
+
+    colored_allocator alloc(BLOCK_SIZE);
+    alloc.set_alignment(PAGE_SIZE);
+    colored_allocator copy(alloc);
+
+    // copies share the pool, so blocks added by them get successive colors
+    std::vector<int*> ptrs;
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < 4; ++i) {
+        colored_allocator& owner = (i % 2 == 0) ? alloc : copy;
+        int* ptr = owner.allocate(1, nullptr);
+        ptrs.push_back(ptr);
+        offsets.push_back(reinterpret_cast<std::uintptr_t>(ptr) % PAGE_SIZE);
+        for (size_t j = 1; j < BLOCK_SIZE; ++j) {
+            ptrs.push_back(owner.allocate(1, nullptr));
+        }
+    }
+    std::sort(offsets.begin(), offsets.end());
+    EXPECT_EQ(offsets.end(), std::unique(offsets.begin(), offsets.end()));
+    EXPECT_EQ(3 * CACHE_LINE_SIZE, offsets.back() - offsets.front());
+
+    for (int* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+    EXPECT_EQ(4 * BLOCK_SIZE, alloc.trim(0));
+}
+
+TEST(wide_pool_allocation_policy_test, test_allocate)
+{
+    struct wide_pool_traits: public default_pool_traits
+    {
+        typedef std::uint16_t chunk_index_type;
+    };
+
+    typedef basic_pool_allocation_policy<char, allocation_traits<char>, wide_pool_traits,
+                                            default_allocation_policy<char, allocation_traits<char>,
+                                                statistic_policy<char>
+                                            >
+                                        > wide_char_allocator;
+    typedef typename wide_char_allocator::statistic_type statistic;
+
+    const size_t BLOCK_SIZE = 1000;
+    EXPECT_EQ(sizeof(std::uint16_t), wide_char_allocator::SLOT_SIZE);
+
+    statistic stat;
+    wide_char_allocator alloc(BLOCK_SIZE);
+    alloc.set_statistic(&stat);
+
+    std::vector<char*> ptrs;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        char* ptr = alloc.allocate(1, nullptr);
+        ASSERT_NE(nullptr, ptr);
+        *ptr = 42;
+        ptrs.push_back(ptr);
+    }
+    EXPECT_EQ(1, stat.allocs_count());
+    EXPECT_EQ(BLOCK_SIZE * wide_char_allocator::SLOT_SIZE, stat.mem_used());
+
+    for (char* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+    EXPECT_EQ(0, stat.deallocs_count());
+    EXPECT_EQ(BLOCK_SIZE, alloc.capacity());
+}
+
+TEST(pools_manager_test, test_deallocate)
+{
+    typedef details::pools_manager<std::uint8_t*, size_t> manager_type;
+    typedef manager_type::pool_type pool_type;
+
+    const size_t BLOCK_SIZE = 4;
+    const size_t SMALL_OBJ_SIZE = 4;
+    const size_t LARGE_OBJ_SIZE = 8;
+
+    std::uint8_t small_mem[2][BLOCK_SIZE * SMALL_OBJ_SIZE];
+    std::uint8_t large_mem[BLOCK_SIZE * LARGE_OBJ_SIZE];
+    std::uint8_t foreign_mem[LARGE_OBJ_SIZE];
+
+    manager_type manager;
+    pool_type* small_pool = manager.get_pool(SMALL_OBJ_SIZE);
+    pool_type* large_pool = manager.get_pool(LARGE_OBJ_SIZE);
+    manager.add_mem_block(small_pool, small_mem[0], BLOCK_SIZE);
+    manager.add_mem_block(large_pool, large_mem, BLOCK_SIZE);
+    manager.add_mem_block(small_pool, small_mem[1], BLOCK_SIZE);
+
+    std::vector<std::uint8_t*> small_ptrs;
+    for (size_t i = 0; i < 2 * BLOCK_SIZE; ++i) {
+        small_ptrs.push_back(small_pool->allocate());
+    }
+    std::uint8_t* large_ptr = large_pool->allocate();
+    EXPECT_FALSE(small_pool->is_memory_available());
+
+    EXPECT_EQ(large_pool, manager.find_pool(large_ptr));
+    EXPECT_EQ(nullptr, manager.find_pool(foreign_mem));
+    EXPECT_FALSE(manager.deallocate(foreign_mem));
+
+    for (auto ptr: small_ptrs) {
+        EXPECT_EQ(small_pool, manager.find_pool(ptr));
+        EXPECT_TRUE(manager.deallocate(ptr));
+    }
+    EXPECT_EQ(2 * BLOCK_SIZE, small_pool->available());
+    EXPECT_TRUE(manager.deallocate(large_ptr));
+    EXPECT_EQ(BLOCK_SIZE, large_pool->available());
+
+    manager.release_pool(SMALL_OBJ_SIZE);
+    manager.erase_pool(SMALL_OBJ_SIZE);
+    EXPECT_FALSE(manager.is_owned(small_mem[0]));
+    EXPECT_TRUE(manager.is_owned(large_mem));
+}
+
+TEST(pools_manager_test, test_trim)
+{
+    typedef details::pools_manager<std::uint8_t*, size_t> manager_type;
+    typedef manager_type::pool_type pool_type;
+
+    const size_t BLOCK_SIZE = 4;
+    const size_t OBJ_SIZE = 4;
+
+    std::uint8_t mem[3][BLOCK_SIZE * OBJ_SIZE];
+
+    manager_type manager;
+    pool_type* pool = manager.get_pool(OBJ_SIZE);
+    for (auto& block: mem) {
+        manager.add_mem_block(pool, block, BLOCK_SIZE);
+    }
+    std::vector<std::uint8_t*> ptrs;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        ptrs.push_back(pool->allocate());
+    }
+
+    size_t released_num = 0;
+    EXPECT_EQ(2 * BLOCK_SIZE, manager.trim(pool, 0, [&released_num](std::uint8_t*, size_t) { ++released_num; }));
+    EXPECT_EQ(2u, released_num);
+
+    // the registry follows the blocks of the pool
+    size_t owned_blocks = 0;
+    for (auto& block: mem) {
+        owned_blocks += manager.is_owned(block) ? 1 : 0;
+    }
+    EXPECT_EQ(1u, owned_blocks);
+    for (auto ptr: ptrs) {
+        EXPECT_EQ(pool, manager.find_pool(ptr));
+        EXPECT_TRUE(manager.deallocate(ptr));
+    }
+    EXPECT_EQ(BLOCK_SIZE, pool->available());
+}
+
+namespace
+{
+
+struct cached_pool_traits: public default_pool_traits
+{
+    typedef std::mutex mutex_type;
+    static const std::size_t THREAD_CACHE_SIZE = 8;
+};
+
+typedef basic_pool_allocation_policy<size_t, allocation_traits<size_t>, cached_pool_traits,
+                                        default_allocation_policy<size_t, allocation_traits<size_t>,
+                                            statistic_policy<size_t>
+                                        >
+                                    > cached_allocator;
+
+}
+
+TEST(cached_pool_allocation_policy_test, test_reuse)
+{
+    cached_allocator alloc;
+    size_t* ptr = alloc.allocate(1, nullptr);
+    alloc.deallocate(ptr, 1);
+    EXPECT_EQ(ptr, alloc.allocate(1, nullptr));
+    alloc.deallocate(ptr, 1);
+}
+
+TEST(cached_pool_allocation_policy_test, test_flush_other_objects)
+{
+    typedef default_allocation_policy<size_t, allocation_traits<size_t>, statistic_policy<size_t>> base_allocator;
+    typedef typename cached_allocator::statistic_type statistic;
+
+    statistic stat;
+    cached_allocator alloc(16);
+    alloc.set_statistic(&stat);
+
+    // the first object is allocated from the new block directly and the others are taken
+    // by the cache in batches of half of its size, so the cache is empty after that
+    std::vector<size_t*> ptrs;
+    for (size_t i = 0; i < cached_pool_traits::THREAD_CACHE_SIZE + 1; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    EXPECT_EQ(1, stat.allocs_count());
+
+    // the object of base_policy is cached along with objects of the pool
+    // and given back to base_policy when the cache is flushed
+    size_t* other = static_cast<base_allocator&>(alloc).allocate(1, nullptr);
+    for (size_t i = 0; i + 1 < cached_pool_traits::THREAD_CACHE_SIZE; ++i) {
+        alloc.deallocate(ptrs[i], 1);
+    }
+    alloc.deallocate(other, 1);
+    EXPECT_EQ(0, stat.deallocs_count());
+    alloc.deallocate(ptrs[cached_pool_traits::THREAD_CACHE_SIZE - 1], 1);
+    EXPECT_EQ(1, stat.deallocs_count());
+    EXPECT_EQ(16 * sizeof(size_t), stat.mem_used());
+    alloc.deallocate(ptrs.back(), 1);
+}
+
+TEST(cached_pool_allocation_policy_test, test_threads)
+{
+    typedef typename cached_allocator::statistic_type statistic;
+
+    const size_t BLOCK_SIZE = 64;
+    const size_t THREADS_NUM = 4;
+    const size_t ITER_NUM = 1000;
+    const size_t OBJ_NUM = 50;
+
+    statistic stat;
+    cached_allocator alloc(BLOCK_SIZE);
+    alloc.set_statistic(&stat);
+
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < THREADS_NUM; ++id) {
+        threads.emplace_back([alloc, id] () mutable {
+            std::vector<size_t*> ptrs;
+            for (size_t i = 0; i < ITER_NUM; ++i) {
+                for (size_t j = 0; j < OBJ_NUM; ++j) {
+                    ptrs.push_back(alloc.allocate(1, nullptr));
+                    *ptrs.back() = id;
+                }
+                for (size_t* ptr: ptrs) {
+                    ASSERT_EQ(id, *ptr);
+                    alloc.deallocate(ptr, 1);
+                }
+                ptrs.clear();
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    // caches of finished threads should be returned to the pool,
+    // so all its memory is available again
+    size_t allocs_count = stat.allocs_count();
+    size_t capacity = alloc.capacity();
+    std::vector<size_t*> ptrs;
+    for (size_t i = 0; i < capacity; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    EXPECT_EQ(allocs_count, stat.allocs_count());
+    std::sort(ptrs.begin(), ptrs.end());
+    EXPECT_TRUE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+    for (size_t* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+}
+
+TEST(thread_safe_pool_allocation_policy_test, test_stress)
+{
+    struct safe_pool_traits: public default_pool_traits
+    {
+        typedef std::mutex mutex_type;
+    };
+
+    typedef basic_pool_allocation_policy<size_t, allocation_traits<size_t>, safe_pool_traits> safe_allocator;
+    typedef safe_allocator::rebind<std::pair<size_t, size_t>> safe_pair_allocator;
+
+    const size_t BLOCK_SIZE = 16;
+    const size_t THREADS_NUM = 4;
+    const size_t ITER_NUM = 20000;
+
+    safe_allocator alloc(BLOCK_SIZE);
+
+    // objects allocated by one thread and deallocated by another
+    std::mutex shared_mutex;
+    std::vector<size_t*> shared_ptrs;
+
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < THREADS_NUM; ++id) {
+        threads.emplace_back([alloc, id, &shared_mutex, &shared_ptrs] () mutable {
+            std::default_random_engine eng(id);
+            std::vector<size_t*> ptrs;
+            for (size_t i = 0; i < ITER_NUM; ++i) {
+                switch (eng() % 4) {
+                case 0: {
+                    // pool of other size is created and destroyed concurrently with other threads
+                    safe_pair_allocator pair_alloc(alloc);
+                    std::pair<size_t, size_t>* pair = pair_alloc.allocate(1, nullptr);
+                    pair->first = pair->second = id;
+                    ASSERT_EQ(id, pair->first);
+                    pair_alloc.deallocate(pair, 1);
+                    break;
+                }
+                case 1: {
+                    std::lock_guard<std::mutex> lock(shared_mutex);
+                    if (!shared_ptrs.empty()) {
+                        alloc.deallocate(shared_ptrs.back(), 1);
+                        shared_ptrs.pop_back();
+                    }
+                    break;
+                }
+                case 2:
+                    if (!ptrs.empty()) {
+                        ASSERT_EQ(id, *ptrs.back());
+                        std::lock_guard<std::mutex> lock(shared_mutex);
+                        shared_ptrs.push_back(ptrs.back());
+                        ptrs.pop_back();
+                    }
+                    break;
+                default:
+                    ptrs.push_back(alloc.allocate(1, nullptr));
+                    *ptrs.back() = id;
+                }
+            }
+            for (size_t* ptr: ptrs) {
+                ASSERT_EQ(id, *ptr);
+                alloc.deallocate(ptr, 1);
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    for (size_t* ptr: shared_ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+
+    // all objects are returned to the pool, so its whole capacity can be allocated again
+    size_t capacity = alloc.capacity();
+    std::vector<size_t*> ptrs;
+    for (size_t i = 0; i < capacity; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    EXPECT_EQ(capacity, alloc.capacity());
+    std::sort(ptrs.begin(), ptrs.end());
+    EXPECT_TRUE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+    for (size_t* ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+}
+
+TEST(memory_pool_remote_test, test_collect_remote)
+{
+    typedef details::memory_pool<std::uint8_t*, size_t> pool_type;
+
+    const size_t OBJ_NUM = 4;
+
+    void* mem[OBJ_NUM];
+    pool_type pool(sizeof(void*));
+    pool.add_mem_block(reinterpret_cast<std::uint8_t*>(mem), OBJ_NUM);
+
+    std::vector<std::uint8_t*> ptrs;
+    for (size_t i = 0; i < OBJ_NUM; ++i) {
+        ptrs.push_back(pool.allocate());
+    }
+    EXPECT_FALSE(pool.has_remote_frees());
+
+    std::thread remote([&ptrs, &pool] () {
+        for (auto ptr: ptrs) {
+            pool.remote_deallocate(ptr);
+        }
+    });
+    remote.join();
+
+    // remotely deallocated objects are unavailable until they are collected
+    EXPECT_TRUE(pool.has_remote_frees());
+    EXPECT_EQ(0, pool.available());
+    EXPECT_EQ(OBJ_NUM, pool.collect_remote());
+    EXPECT_FALSE(pool.has_remote_frees());
+    EXPECT_EQ(OBJ_NUM, pool.available());
+    EXPECT_EQ(0, pool.collect_remote());
+}
+
+namespace
+{
+
+struct remote_free_pool_traits: public default_pool_traits
+{
+    typedef std::mutex mutex_type;
+    static const bool REMOTE_FREE = true;
+};
+
+}
+
+TEST(remote_free_pool_allocation_policy_test, test_unowned)
+{
+    typedef default_allocation_policy<size_t, allocation_traits<size_t>, statistic_policy<size_t>> base_allocator;
+    typedef basic_pool_allocation_policy<size_t, allocation_traits<size_t>, remote_free_pool_traits,
+                                            base_allocator
+                                        > remote_free_allocator;
+    typedef typename remote_free_allocator::statistic_type statistic;
+
+    statistic stat;
+    if (true) {
+        remote_free_allocator alloc(16);
+        alloc.set_statistic(&stat);
+        size_t* ptr = alloc.allocate(1, nullptr);
+        EXPECT_EQ(1, stat.allocs_count());
+
+        // objects of base_policy are deallocated remotely as well,
+        // they are given back to base_policy after the remote frees are collected
+        size_t* other = static_cast<base_allocator&>(alloc).allocate(1, nullptr);
+        alloc.deallocate(other, 1);
+        alloc.deallocate(ptr, 1);
+        alloc.trim(16);
+        EXPECT_EQ(0, stat.deallocs_count());
+        ptr = alloc.allocate(1, nullptr);
+        EXPECT_EQ(1, stat.deallocs_count());
+        EXPECT_EQ(16 * sizeof(size_t), stat.mem_used());
+
+        // and when the pool is destroyed
+        other = static_cast<base_allocator&>(alloc).allocate(1, nullptr);
+        alloc.deallocate(other, 1);
+        alloc.deallocate(ptr, 1);
+    }
+    EXPECT_EQ(3, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST(remote_free_pool_allocation_policy_test, test_producer_consumer)
+{
+    typedef basic_pool_allocation_policy<std::uint32_t, allocation_traits<std::uint32_t>, remote_free_pool_traits,
+                                            default_allocation_policy<std::uint32_t, allocation_traits<std::uint32_t>,
+                                                statistic_policy<std::uint32_t>
+                                            >
+                                        > remote_free_allocator;
+    typedef typename remote_free_allocator::statistic_type statistic;
+
+    const size_t BLOCK_SIZE = 64;
+    const size_t MSG_NUM = 100000;
+    const size_t MAX_QUEUE_SIZE = 1000;
+
+    EXPECT_EQ(sizeof(void*), remote_free_allocator::SLOT_SIZE);
+
+    statistic stat;
+    remote_free_allocator alloc(BLOCK_SIZE);
+    alloc.set_statistic(&stat);
+
+    std::mutex queue_mutex;
+    std::vector<std::uint32_t*> queue;
+    bool done = false;
+
+    std::thread consumer([alloc, &queue_mutex, &queue, &done] () mutable {
+        std::vector<std::uint32_t*> msgs;
+        bool finished = false;
+        std::uint32_t expected = 0;
+        while (!finished) {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                msgs.swap(queue);
+                finished = done && msgs.empty();
+            }
+            for (auto msg: msgs) {
+                ASSERT_EQ(expected++, *msg);
+                alloc.deallocate(msg, 1);
+            }
+            msgs.clear();
+        }
+    });
+
+    for (std::uint32_t i = 0; i < MSG_NUM; ++i) {
+        std::uint32_t* msg = alloc.allocate(1, nullptr);
+        *msg = i;
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue.push_back(msg);
+        // producer doesn't run too far ahead of consumer, so the number of messages in flight is bounded
+        while (queue.size() >= MAX_QUEUE_SIZE) {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        done = true;
+    }
+    consumer.join();
+
+    // memory deallocated by consumer is reused by producer, so the pool doesn't grow with the number of messages
+    EXPECT_LT(alloc.capacity(), MSG_NUM / 2);
+
+    size_t allocs_count = stat.allocs_count();
+    size_t capacity = alloc.capacity();
+    std::vector<std::uint32_t*> ptrs;
+    for (size_t i = 0; i < capacity; ++i) {
+        ptrs.push_back(alloc.allocate(1, nullptr));
+    }
+    EXPECT_EQ(allocs_count, stat.allocs_count());
+    for (auto ptr: ptrs) {
+        alloc.deallocate(ptr, 1);
+    }
+}
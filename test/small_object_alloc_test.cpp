@@ -0,0 +1,154 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "allocator.hpp"
+#include "alloc_policies.hpp"
+#include "small_object_allocation.hpp"
+#include "statistic_policy.hpp"
+
+using namespace alloc_utility;
+
+class small_object_allocation_policy_test: public ::testing::Test
+{
+public:
+
+    typedef small_object_allocation_policy<char, allocation_traits<char>, default_pool_traits,
+                                            default_allocation_policy<char, allocation_traits<char>,
+                                                statistic_policy<char>
+                                            >
+                                        > test_policy;
+
+    typedef test_policy::statistic_type statistic_type;
+
+    small_object_allocation_policy_test()
+    {
+        alloc.set_statistic(&stat);
+    }
+
+    statistic_type stat;
+    test_policy alloc;
+};
+
+TEST_F(small_object_allocation_policy_test, test_slot_size)
+{
+    EXPECT_EQ(8u, test_policy::slot_size(1));
+    EXPECT_EQ(8u, test_policy::slot_size(8));
+    EXPECT_EQ(16u, test_policy::slot_size(9));
+    EXPECT_EQ(48u, test_policy::slot_size(33));
+    EXPECT_EQ(128u, test_policy::slot_size(128));
+    EXPECT_EQ(160u, test_policy::slot_size(129));
+    EXPECT_EQ(256u, test_policy::slot_size(256));
+    EXPECT_EQ(0u, test_policy::slot_size(257));
+    EXPECT_EQ(0u, test_policy::slot_size(0));
+
+    typedef test_policy::rebind<std::uint64_t> u64_policy;
+    EXPECT_EQ(32u, u64_policy::slot_size(3));
+    EXPECT_EQ(256u, u64_policy::slot_size(32));
+    EXPECT_EQ(0u, u64_policy::slot_size(33));
+}
+
+TEST_F(small_object_allocation_policy_test, test_allocate)
+{
+    const size_t SIZE = 100;
+
+    alloc.set_block_size(SIZE);
+    std::vector<char*> ptrs;
+    for (size_t i = 0; i < SIZE; ++i) {
+        char* ptr = alloc.allocate(20, nullptr);
+        ASSERT_NE(nullptr, ptr);
+        std::memset(ptr, static_cast<int>(i), 20);
+        ptrs.push_back(ptr);
+    }
+    // all requests fit into one block of 32 byte size class
+    EXPECT_EQ(1, stat.allocs_count());
+    EXPECT_EQ(SIZE * 32, stat.mem_used());
+    EXPECT_EQ(SIZE, alloc.capacity(20));
+    EXPECT_EQ(SIZE, alloc.capacity(32));
+    EXPECT_EQ(0u, alloc.capacity(33));
+    for (size_t i = 0; i < SIZE; ++i) {
+        EXPECT_EQ(static_cast<char>(i), ptrs[i][19]);
+    }
+
+    // other size classes have their own pools
+    char* small_ptr = alloc.allocate(1, nullptr);
+    EXPECT_EQ(2, stat.allocs_count());
+
+    // large requests go to base_policy directly
+    char* large_ptr = alloc.allocate(1000, nullptr);
+    EXPECT_EQ(3, stat.allocs_count());
+    alloc.deallocate(large_ptr, 1000);
+    EXPECT_EQ(1, stat.deallocs_count());
+
+    alloc.deallocate(small_ptr, 1);
+    for (char* ptr: ptrs) {
+        alloc.deallocate(ptr, 20);
+    }
+    EXPECT_EQ(1, stat.deallocs_count());
+    EXPECT_EQ(SIZE, alloc.capacity(20));
+}
+
+TEST_F(small_object_allocation_policy_test, test_rebind)
+{
+    typedef test_policy::rebind<std::uint32_t> u32_policy;
+
+    statistic_type u32_stat;
+    if (true) {
+        u32_policy u32_alloc(alloc);
+        u32_alloc.set_statistic(&u32_stat);
+        EXPECT_TRUE(alloc == test_policy(u32_alloc));
+
+        // 4 uint32 and 16 chars are in the same size class
+        std::uint32_t* u32_ptr = u32_alloc.allocate(4, nullptr);
+        EXPECT_EQ(1, u32_stat.allocs_count());
+        char* ptr = alloc.allocate(16, nullptr);
+        EXPECT_EQ(0, stat.allocs_count());
+        EXPECT_EQ(alloc.capacity(16), u32_alloc.capacity(4));
+
+        alloc.deallocate(ptr, 16);
+        u32_alloc.deallocate(u32_ptr, 4);
+    }
+    // pools are kept while any copy is alive
+    EXPECT_EQ(0, u32_stat.deallocs_count());
+    EXPECT_LT(0u, alloc.capacity(16));
+}
+
+TEST_F(small_object_allocation_policy_test, test_destroy)
+{
+    if (true) {
+        test_policy local_alloc;
+        local_alloc.set_statistic(&stat);
+        test_policy copy = local_alloc;
+        for (size_t n: {1, 10, 100, 200}) {
+            local_alloc.allocate(n, nullptr);
+        }
+        EXPECT_EQ(4, stat.allocs_count());
+    }
+    EXPECT_EQ(4, stat.deallocs_count());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
+TEST(small_object_allocator_test, test_containers)
+{
+    typedef allocator<char, allocation_traits<char>,
+                        small_object_allocation_policy<char>,
+                        default_allocation_policy<char>
+                     > char_allocator;
+    typedef std::basic_string<char, std::char_traits<char>, char_allocator> test_string;
+    typedef std::vector<int, char_allocator::rebind<int>::other> test_vector;
+
+    char_allocator alloc;
+    test_vector vec(alloc);
+    std::vector<test_string> strings;
+    for (int i = 0; i < 100; ++i) {
+        vec.push_back(i);
+        strings.emplace_back(std::string(i, 'a').c_str(), alloc);
+    }
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(i, vec[i]);
+        EXPECT_EQ(static_cast<size_t>(i), strings[i].size());
+    }
+}
@@ -52,6 +52,17 @@ TEST_F(simple_statistic_test, test_mem_used)
     EXPECT_EQ(0, stat.mem_used());
 }
 
+TEST_F(simple_statistic_test, test_purges)
+{
+    EXPECT_EQ(0, stat.purges_count());
+    EXPECT_EQ(0, stat.purged_mem());
+    stat.register_purge(4096);
+    stat.register_purge(8192);
+    EXPECT_EQ(2, stat.purges_count());
+    EXPECT_EQ(3 * 4096, stat.purged_mem());
+    EXPECT_EQ(0, stat.mem_used());
+}
+
 class statistic_policy_test: public ::testing::Test
 {
 public: